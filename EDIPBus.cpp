@@ -0,0 +1,222 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPBus.h"
+
+// no display selected or selection unknown
+#define NOT_SELECTED -1
+
+
+EDIPBusQueue::EDIPBusQueue(EDIPBus& bus, unsigned char address) {
+  _bus = &bus;
+  _address = address;
+  _len = 0;
+  _complete = 0;
+  _dropping = false;
+  _error = EDIP_OK;
+  _credit = 0;
+  _next = 0;
+  bus.add(this);
+}
+
+
+size_t EDIPBusQueue::write(const char* buf, size_t len) {
+  size_t chunk, done = 0;
+  char result;
+
+  if (_dropping) {
+    // rest of a command that could not be queued
+    return len;
+  }
+  while (done < len) {
+    if (_len == EDIPBUS_QUEUE_SIZE) {
+      // no room left, this display gets the bus now
+      result = _bus->send(this, _len);
+      if (_len == EDIPBUS_QUEUE_SIZE) {
+        // still not sent: drop the whole command, keep the ones before
+        _len = _complete;
+        _dropping = true;
+        _error = result;
+        return len;
+      }
+    }
+    chunk = EDIPBUS_QUEUE_SIZE - _len;
+    if (chunk > len - done) {
+      chunk = len - done;
+    }
+    memcpy(_data + _len, buf + done, chunk);
+    _len += chunk;
+    done += chunk;
+  }
+  return done;
+}
+
+
+int EDIPBusQueue::available() {
+  // responses are read through the link, see EDIPBus::select()
+  return 0;
+}
+
+
+int EDIPBusQueue::read() {
+  return -1;
+}
+
+
+bool EDIPBusQueue::requests() {
+  return false;
+}
+
+
+char EDIPBusQueue::commandDone() {
+  char result = _error;
+  _complete = _len;
+  _dropping = false;
+  _error = EDIP_OK;
+  return result;
+}
+
+
+EDIPBusDisplay::EDIPBusDisplay(EDIPBus& bus, unsigned char address) :
+    EDIPBusQueue(bus, address),
+    EDIPTFT(*this, false, bus.link().coordSize()) {
+}
+
+
+EDIPBus::EDIPBus(EDIPTFT& link) {
+  _link = &link;
+  _queues = 0;
+  _turn = 0;
+  _selected = NOT_SELECTED;
+}
+
+
+void EDIPBus::add(EDIPBusQueue* queue) {
+  EDIPBusQueue** last = &_queues;
+  // turns follow the order of construction
+  while (*last) {
+    last = &(*last)->_next;
+  }
+  *last = queue;
+}
+
+
+char EDIPBus::send(EDIPBusQueue* queue, unsigned int len) {
+  char result;
+
+  if (_selected != queue->_address) {
+    result = _link->smallProtoSelect(queue->_address);
+    if (result != EDIP_OK) {
+      _selected = NOT_SELECTED;
+      return result;
+    }
+    _selected = queue->_address;
+  }
+  result = _link->sendCommands(queue->_data, len);
+  // the display may not have seen all of it, but trying again could
+  // repeat commands; the link reports the error
+  queue->_len -= len;
+  queue->_complete = queue->_complete > len ? queue->_complete - len : 0;
+  memmove(queue->_data, queue->_data + len, queue->_len);
+  return result;
+}
+
+
+char EDIPBus::poll() {
+  EDIPBusQueue* start;
+  EDIPBusQueue* queue;
+  unsigned int len;
+  char result = EDIP_OK;
+
+  // round robin, starting behind the display that had the last turn
+  start = _turn && _turn->_next ? _turn->_next : _queues;
+  queue = start;
+  while (queue && queue->_len == 0) {
+    queue = queue->_next ? queue->_next : _queues;
+    if (queue == start) {
+      queue = 0;
+    }
+  }
+  if (queue) {
+    _turn = queue;
+    queue->_credit += EDIPBUS_QUANTUM;
+    len = queue->_len < queue->_credit ? queue->_len : queue->_credit;
+    result = send(queue, len);
+    if (result == EDIP_OK) {
+      // unused credit is only kept while there is more to send
+      queue->_credit = queue->_len ? queue->_credit - len : 0;
+    }
+    else {
+      // a failed turn doesn't count
+      queue->_credit -= EDIPBUS_QUANTUM;
+    }
+  }
+  _link->poll();
+  return result;
+}
+
+
+char EDIPBus::flush() {
+  char result;
+
+  while (pending() > 0) {
+    result = poll();
+    if (result != EDIP_OK) {
+      return result;
+    }
+  }
+  return _link->flush();
+}
+
+
+char EDIPBus::select(EDIPBusDisplay& display) {
+  EDIPBusQueue* queue = &display;
+  char result;
+
+  if (queue->_len > 0) {
+    result = send(queue, queue->_len);
+  }
+  else if (_selected != queue->_address) {
+    result = _link->smallProtoSelect(queue->_address);
+    _selected = result == EDIP_OK ? queue->_address : NOT_SELECTED;
+  }
+  else {
+    return EDIP_OK;
+  }
+  return result == EDIP_OK ? _link->flush() : result;
+}
+
+
+EDIPTFT& EDIPBus::link() {
+  return *_link;
+}
+
+
+unsigned int EDIPBus::pending() {
+  EDIPBusQueue* queue;
+  unsigned int len = 0;
+  for (queue = _queues; queue; queue = queue->_next) {
+    len += queue->_len;
+  }
+  return len;
+}
@@ -0,0 +1,148 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPBus_h
+#define EDIPBus_h
+
+#include "EDIPTFT.h"
+
+// Bytes of commands that can wait for each display
+#ifndef EDIPBUS_QUEUE_SIZE
+#define EDIPBUS_QUEUE_SIZE 128
+#endif
+
+// Bytes a display may send per turn before the next display gets the bus
+#ifndef EDIPBUS_QUANTUM
+#define EDIPBUS_QUANTUM 128
+#endif
+
+class EDIPBus;
+
+/*! \brief Command queue of one display on an EDIPBus
+ */
+class EDIPBusQueue : public EDIPTransport {
+  public:
+    size_t write(const char* buf, size_t len);
+    int available();
+    int read();
+    bool requests();
+    char commandDone();
+
+  protected:
+    EDIPBusQueue(EDIPBus& bus, unsigned char address);
+
+  private:
+    friend class EDIPBus;
+    EDIPBus* _bus;
+    unsigned char _address;
+    char _data[EDIPBUS_QUEUE_SIZE];
+    unsigned int _len;
+    unsigned int _complete;
+    boolean _dropping;
+    char _error;
+    unsigned int _credit;
+    EDIPBusQueue* _next;
+};
+
+/*! \brief One display on an EDIPBus
+ *
+ * Draw on it like on any EDIPTFT. The commands are queued and sent by
+ * the bus; a full queue is sent right away. If that fails, the command
+ * is dropped as a whole and returns the error. Each display has its own
+ * state cache, so it also works across displays.
+ *
+ * Responses can't be read through the queue, so the requests are not
+ * available here and fail with `EDIP_ERR_UNSUPPORTED` when called through
+ * an EDIPTFT reference (e.g. by EDIPEvents). Use EDIPBus::select() and
+ * the link instead.
+ */
+class EDIPBusDisplay : public EDIPBusQueue, public EDIPTFT {
+  public:
+    EDIPBusDisplay(EDIPBus& bus, unsigned char address);
+
+  private:
+    using EDIPTFT::negotiate;
+    using EDIPTFT::protocolInfo;
+    using EDIPTFT::setProtocol;
+    using EDIPTFT::setBaudRate;
+    using EDIPTFT::datainBuffer;
+    using EDIPTFT::readBuffer;
+    using EDIPTFT::smallProtoSelect;
+    using EDIPTFT::smallProtoDeselect;
+};
+
+/*! \brief Several addressed displays on one line (e.g. RS-485)
+ *
+ * Sends the queued commands of all EDIPBusDisplay objects over \a link,
+ * an EDIPTFT on the shared port. A display is selected
+ * (EDIPTFT::smallProtoSelect()) only when the target changes, and the
+ * displays take turns: each one sends up to EDIPBUS_QUANTUM bytes per
+ * turn, so a busy display cannot hold the bus.
+ *
+ *     EDIPTFT link(port);
+ *     EDIPBus bus(link);
+ *     EDIPBusDisplay left(bus, 1), right(bus, 2);
+ *     ...
+ *     left.drawText(0, 0, 'L', "left");
+ *     right.drawText(0, 0, 'L', "right");
+ *     bus.flush();  // or bus.poll() in loop()
+ *
+ * For requests (readBuffer(), ...) select the display with select() and
+ * use \a link.
+ */
+class EDIPBus {
+  public:
+    EDIPBus(EDIPTFT& link);
+
+    /*! \brief Give the next display with queued commands its turn
+     *
+     * Call regularly from the main loop.
+     */
+    char poll();
+
+    /*! \brief Send all queued commands
+     */
+    char flush();
+
+    /*! \brief Send the queued commands of \a display and keep it selected
+     */
+    char select(EDIPBusDisplay& display);
+
+    /*! \brief EDIPTFT on the shared port
+     */
+    EDIPTFT& link();
+
+    /*! \brief Bytes waiting in all queues
+     */
+    unsigned int pending();
+
+  private:
+    friend class EDIPBusQueue;
+    EDIPTFT* _link;
+    EDIPBusQueue* _queues;
+    EDIPBusQueue* _turn;
+    int _selected;
+    void add(EDIPBusQueue* queue);
+    char send(EDIPBusQueue* queue, unsigned int len);
+};
+#endif
@@ -0,0 +1,98 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPCommandList.h"
+
+// ESC and the two command letters
+#define HEADER_SIZE 3
+
+
+EDIPCommandList::EDIPCommandList(char* buffer, unsigned int size) {
+  _tft = 0;
+  _buffer = buffer;
+  _size = size;
+  _len = 0;
+}
+
+
+void EDIPCommandList::begin(EDIPTFT& tft) {
+  _tft = &tft;
+  _len = 0;
+  tft.beginRecording(_buffer, _size);
+}
+
+
+int EDIPCommandList::end() {
+  int result = _tft->endRecording();
+  _len = result < 0 ? 0 : result;
+  return result;
+}
+
+
+unsigned int EDIPCommandList::mark() {
+  return _tft->recordedBytes();
+}
+
+
+boolean EDIPCommandList::fits(unsigned int pos, unsigned char len) {
+  return pos + len <= _len;
+}
+
+
+boolean EDIPCommandList::patchByte(unsigned int at, unsigned char offset,
+                                   char value) {
+  unsigned int pos = at + HEADER_SIZE + offset;
+  if (!fits(pos, 1)) {
+    return false;
+  }
+  _buffer[pos] = value;
+  return true;
+}
+
+
+boolean EDIPCommandList::patchCoord(unsigned int at, unsigned char n,
+                                    int value, unsigned char offset) {
+  unsigned char coordSize = _tft->coordSize();
+  unsigned int pos = at + HEADER_SIZE + offset + n * coordSize;
+  if (!fits(pos, coordSize)) {
+    return false;
+  }
+  _buffer[pos] = lowByte(value);
+  if (coordSize == 2) {
+    _buffer[pos + 1] = highByte(value);
+  }
+  return true;
+}
+
+
+char EDIPCommandList::replay() {
+  if (_len == 0) {
+    return EDIP_OK;
+  }
+  return _tft->sendCommands(_buffer, _len);
+}
+
+
+unsigned int EDIPCommandList::length() {
+  return _len;
+}
@@ -0,0 +1,116 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPCommandList_h
+#define EDIPCommandList_h
+
+#include "EDIPTFT.h"
+
+/*! \brief Pre-encoded command sequence
+ *
+ * Records the ESC commands of a sequence of EDIPTFT calls once and sends
+ * them again with replay(), in as few packets as possible and without
+ * encoding them again. Parameters of marked commands can be changed in
+ * place before a replay:
+ *
+ *     char buf[64];
+ *     EDIPCommandList row(buf, sizeof(buf));
+ *     unsigned int box, value;
+ *
+ *     row.begin(tft);
+ *     box = row.mark();
+ *     tft.fillRect(0, 0, 100, 20);
+ *     value = row.mark();
+ *     tft.updateBargraph(1, 0);
+ *     row.end();
+ *     ...
+ *     row.patchCoord(box, 1, y);      // y1 of the rectangle
+ *     row.patchCoord(box, 3, y + 20); // y2
+ *     row.patchByte(value, 1, level); // bargraph value
+ *     row.replay();
+ */
+class EDIPCommandList {
+  public:
+    EDIPCommandList(char* buffer, unsigned int size);
+
+    /*! \brief Start recording the calls to \a tft
+     *
+     * Nothing is sent to \a tft until end(), see
+     * EDIPTFT::beginRecording().
+     */
+    void begin(EDIPTFT& tft);
+
+    /*! \brief Stop recording
+     *
+     * \return number of recorded bytes or `EDIP_ERR_OVERFLOW`
+     */
+    int end();
+
+    /*! \brief Position of the next recorded command
+     *
+     * Pass it to patchByte()/patchCoord() to change parameters of that
+     * command later. With geometry coalescing on, shapes drawn before a
+     * mark are not merged with shapes drawn after it.
+     */
+    unsigned int mark();
+
+    /*! \brief Change a byte parameter
+     *
+     * \param at position returned by mark()
+     * \param offset offset of the parameter in bytes behind the two
+     *               command letters
+     * \return false if the parameter is outside of the recording
+     */
+    boolean patchByte(unsigned int at, unsigned char offset, char value);
+
+    /*! \brief Change a coordinate parameter
+     *
+     * Lines, rectangles, text, touch keys, touch menus and images start
+     * with their coordinates. Bargraphs (ESC B L/R/O/U) and instruments
+     * (ESC I P) have their number first, pass \a offset 1 for them.
+     *
+     * \param at position returned by mark()
+     * \param n number of the coordinate (0: first)
+     * \param offset bytes in front of the first coordinate, behind the two
+     *               command letters
+     * \return false if the parameter is outside of the recording
+     */
+    boolean patchCoord(unsigned int at, unsigned char n, int value,
+                       unsigned char offset=0);
+
+    /*! \brief Send the recorded commands
+     */
+    char replay();
+
+    /*! \brief Recorded bytes
+     */
+    unsigned int length();
+
+  private:
+    EDIPTFT* _tft;
+    char* _buffer;
+    unsigned int _size;
+    unsigned int _len;
+    boolean fits(unsigned int pos, unsigned char len);
+};
+#endif
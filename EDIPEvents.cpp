@@ -0,0 +1,189 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPEvents.h"
+
+#define STATE_IDLE 0
+#define STATE_COMMAND 1
+#define STATE_LEN 2
+#define STATE_DATA 3
+
+
+EDIPEvents::EDIPEvents() {
+  _state = STATE_IDLE;
+  _head = 0;
+  _count = 0;
+  _dropped = 0;
+  memset(_handlers, 0, sizeof(_handlers));
+}
+
+
+void EDIPEvents::feed(const char* data, int len) {
+  int i;
+  for (i = 0; i < len; i++) {
+    feed(data[i]);
+  }
+}
+
+
+void EDIPEvents::feed(char c) {
+  switch (_state) {
+    case STATE_IDLE:
+      // skip anything until the start of the next response
+      if (c == ESC) {
+        _state = STATE_COMMAND;
+      }
+      return;
+
+    case STATE_COMMAND:
+      _event.command = c;
+      _state = STATE_LEN;
+      return;
+
+    case STATE_LEN:
+      _event.len = c;
+      _pos = 0;
+      if (_event.len == 0) {
+        dispatch();
+      }
+      else {
+        _state = STATE_DATA;
+      }
+      return;
+
+    case STATE_DATA:
+      if (_pos < EDIPEVENTS_MAX_DATA) {
+        _event.data[_pos] = c;
+      }
+      if (++_pos == _event.len) {
+        dispatch();
+      }
+      return;
+  }
+}
+
+
+int EDIPEvents::poll(EDIPTFT& tft) {
+  char data[EDIPTFT_RX_SIZE];
+  int len = tft.readBuffer(data, sizeof(data));
+  if (len > 0) {
+    feed(data, len);
+  }
+  return len;
+}
+
+
+void EDIPEvents::onEvent(char type, EDIPEventHandler handler) {
+  if (type > 0 && type < EDIP_EVENT_TYPES) {
+    _handlers[(unsigned char)type] = handler;
+  }
+}
+
+
+unsigned char EDIPEvents::available() {
+  return _count;
+}
+
+
+boolean EDIPEvents::read(EDIPEvent& event) {
+  if (_count == 0) {
+    return false;
+  }
+  event = _queue[_head];
+  _head = (_head + 1) % EDIPEVENTS_QUEUE_SIZE;
+  _count--;
+  return true;
+}
+
+
+unsigned int EDIPEvents::dropped() {
+  return _dropped;
+}
+
+
+void EDIPEvents::dispatch() {
+  unsigned char* d = (unsigned char*)_event.data;
+  unsigned char n = _event.len;
+
+  _state = STATE_IDLE;
+  _event.type = EDIP_EVENT_OTHER;
+  _event.code = 0;
+  _event.value = 0;
+  _event.x = 0;
+  _event.y = 0;
+
+  switch (_event.command) {
+    case 'A':
+      if (n == 1) {
+        _event.type = EDIP_EVENT_TOUCH;
+        _event.code = d[0];
+      }
+      break;
+    case 'B':
+    case 'I':
+      if (n == 2) {
+        _event.type = _event.command == 'B' ? EDIP_EVENT_BARGRAPH
+                                             : EDIP_EVENT_INSTRUMENT;
+        _event.code = d[0];
+        _event.value = d[1];
+      }
+      break;
+    case 'N':
+      if (n == 1) {
+        _event.type = EDIP_EVENT_MENU;
+        _event.code = d[0];
+      }
+      break;
+    case 'T':
+      if (n == 0) {
+        _event.type = EDIP_EVENT_MENU_REQUEST;
+      }
+      break;
+    case 'H':
+      // action, x, y with 1 or 2 byte coordinates
+      if (n == 3) {
+        _event.type = EDIP_EVENT_FREE_TOUCH;
+        _event.code = d[0];
+        _event.x = d[1];
+        _event.y = d[2];
+      }
+      else if (n == 5) {
+        _event.type = EDIP_EVENT_FREE_TOUCH;
+        _event.code = d[0];
+        _event.x = d[1] | (d[2] << 8);
+        _event.y = d[3] | (d[4] << 8);
+      }
+      break;
+  }
+
+  if (_handlers[(unsigned char)_event.type]) {
+    _handlers[(unsigned char)_event.type](_event);
+  }
+  else if (_count < EDIPEVENTS_QUEUE_SIZE) {
+    _queue[(_head + _count) % EDIPEVENTS_QUEUE_SIZE] = _event;
+    _count++;
+  }
+  else {
+    _dropped++;
+  }
+}
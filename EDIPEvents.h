@@ -0,0 +1,122 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPEvents_h
+#define EDIPEvents_h
+
+#include "EDIPTFT.h"
+
+// Event types
+#define EDIP_EVENT_TOUCH 1         // touch key/switch code (ESC A)
+#define EDIP_EVENT_BARGRAPH 2      // bargraph set by touch (ESC B)
+#define EDIP_EVENT_INSTRUMENT 3    // instrument set by touch (ESC I)
+#define EDIP_EVENT_MENU 4          // menu item selected (ESC N)
+#define EDIP_EVENT_MENU_REQUEST 5  // menu wants to open (ESC T 0)
+#define EDIP_EVENT_FREE_TOUCH 6    // free touch area (ESC H)
+#define EDIP_EVENT_OTHER 7         // any other response
+#define EDIP_EVENT_TYPES 8
+
+// Number of events that can wait in the queue
+#ifndef EDIPEVENTS_QUEUE_SIZE
+#define EDIPEVENTS_QUEUE_SIZE 8
+#endif
+
+// Response bytes kept for EDIP_EVENT_OTHER
+#define EDIPEVENTS_MAX_DATA 8
+
+/*! \brief Response from the send buffer of the display
+ */
+struct EDIPEvent {
+  char type;            // EDIP_EVENT_*
+  unsigned char code;   // touch code, bargraph/instrument number, menu item
+                        // or free touch action
+  unsigned char value;  // bargraph/instrument value
+  int x, y;             // position of a free touch event
+  char command;         // letter after ESC
+  unsigned char len;    // number of parameter bytes
+  char data[EDIPEVENTS_MAX_DATA];  // parameter bytes (truncated)
+};
+
+typedef void (*EDIPEventHandler)(const EDIPEvent& event);
+
+/*! \brief Decoder for the send buffer of the display
+ *
+ * Parses the bytes read with EDIPTFT::readBuffer() (`ESC letter len
+ * data...`) into EDIPEvent records. A response that is split across two
+ * reads is completed by the next feed(). Events are passed to the handler
+ * registered for their type or, without handler, stored in a small queue
+ * for read(). Nothing is allocated dynamically.
+ *
+ *     EDIPEvents events;
+ *     events.onEvent(EDIP_EVENT_TOUCH, keyPressed);
+ *     ...
+ *     events.poll(tft);  // in loop()
+ */
+class EDIPEvents {
+  public:
+    EDIPEvents();
+
+    /*! \brief Decode \a len bytes from the send buffer
+     */
+    void feed(const char* data, int len);
+    void feed(char c);
+
+    /*! \brief Read the send buffer of \a tft and decode it
+     *
+     * \return number of bytes read or error code
+     */
+    int poll(EDIPTFT& tft);
+
+    /*! \brief Call \a handler for events of \a type instead of queueing them
+     *
+     * \param type EDIP_EVENT_* type
+     * \param handler function to call, 0 to queue events again
+     */
+    void onEvent(char type, EDIPEventHandler handler);
+
+    /*! \brief Number of queued events
+     */
+    unsigned char available();
+
+    /*! \brief Take the oldest event from the queue
+     *
+     * \return false if the queue is empty
+     */
+    boolean read(EDIPEvent& event);
+
+    /*! \brief Number of events lost because the queue was full
+     */
+    unsigned int dropped();
+
+  private:
+    unsigned char _state;
+    unsigned char _pos;
+    EDIPEvent _event;
+    EDIPEvent _queue[EDIPEVENTS_QUEUE_SIZE];
+    unsigned char _head;
+    unsigned char _count;
+    unsigned int _dropped;
+    EDIPEventHandler _handlers[EDIP_EVENT_TYPES];
+    void dispatch();
+};
+#endif
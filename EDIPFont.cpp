@@ -0,0 +1,294 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPFont.h"
+
+// Width and height of the built-in fonts. The display does not report
+// the glyph widths of the proportional fonts (EA_GENEVA10 to EA_BIGZIF57),
+// so every character gets the line height, which none of them exceeds.
+static const struct {
+  unsigned char width;
+  unsigned char height;
+} fonts[] = {
+  { 8, 8 },     // EA_FONT8X8
+  { 4, 6 },     // EA_FONT4X6
+  { 6, 8 },     // EA_FONT6X8
+  { 7, 12 },    // EA_FONT7X12
+  { 13, 13 },   // EA_GENEVA10
+  { 17, 17 },   // EA_CHICAGO14
+  { 30, 30 },   // EA_SWISS30B
+  { 57, 57 }    // EA_BIGZIF57
+};
+
+
+EDIPFont::EDIPFont(char font) {
+  if ((unsigned char)font >= sizeof(fonts) / sizeof(fonts[0])) {
+    font = EA_FONT8X8;
+  }
+  _width = fonts[(unsigned char)font].width;
+  _height = fonts[(unsigned char)font].height;
+}
+
+
+EDIPFont::EDIPFont(unsigned char width, unsigned char height) {
+  _width = width;
+  _height = height;
+}
+
+
+unsigned char EDIPFont::height() {
+  return _height;
+}
+
+
+unsigned char EDIPFont::charWidth(char /*c*/) {
+  return _width;
+}
+
+
+// Width of the next character of \a text, which is advanced past it
+unsigned char EDIPFont::glyph(const char*& text, boolean& lineEnd) {
+  char c = *text++;
+
+  lineEnd = false;
+  switch (c) {
+    case '|':
+      lineEnd = true;
+      return 0;
+    case '~':
+    case '@':
+      return 0;
+    case '\\':
+      if (*text == 0) {
+        return 0;
+      }
+      return charWidth(*text++);
+  }
+  return charWidth(c);
+}
+
+
+unsigned int EDIPFont::lineWidth(const char* text) {
+  unsigned int width = 0;
+  unsigned char w;
+  boolean lineEnd;
+
+  while (*text) {
+    w = glyph(text, lineEnd);
+    if (lineEnd) {
+      break;
+    }
+    width += w;
+  }
+  return width;
+}
+
+
+unsigned int EDIPFont::textWidth(const char* text) {
+  unsigned int width = 0, line = 0;
+  unsigned char w;
+  boolean lineEnd;
+
+  while (*text) {
+    w = glyph(text, lineEnd);
+    line += w;
+    if (line > width) {
+      width = line;
+    }
+    if (lineEnd) {
+      line = 0;
+    }
+  }
+  return width;
+}
+
+
+unsigned char EDIPFont::lines(const char* text) {
+  unsigned char n = 1;
+  boolean lineEnd;
+
+  while (*text) {
+    glyph(text, lineEnd);
+    if (lineEnd) {
+      n++;
+    }
+  }
+  return n;
+}
+
+
+EDIPRect EDIPFont::bounds(int x, int y, char justification,
+                          const char* text, char angle) {
+  // along the text u, across the lines v, relative to (x, y)
+  int u1 = 0, u2 = -1, v2, start;
+  unsigned int width;
+  boolean first = true, lineEnd = true;
+  EDIPRect r;
+
+  v2 = lines(text) * _height - 1;
+  while (lineEnd) {
+    width = 0;
+    lineEnd = false;
+    while (*text && !lineEnd) {
+      width += glyph(text, lineEnd);
+    }
+    if (width > 0) {
+      if (justification == 'C') {
+        start = -(int)(width / 2);
+      }
+      else if (justification == 'R') {
+        start = 1 - (int)width;
+      }
+      else {
+        start = 0;
+      }
+      if (first || start < u1) {
+        u1 = start;
+      }
+      if (first || start + (int)width - 1 > u2) {
+        u2 = start + width - 1;
+      }
+      first = false;
+    }
+  }
+
+  if (first) {
+    // nothing visible
+    r.x1 = x;
+    r.y1 = y;
+    r.x2 = x - 1;
+    r.y2 = y - 1;
+  }
+  else if (angle == 1) {
+    // 90°: the text runs upwards, lines follow to the right
+    r.x1 = x;
+    r.x2 = x + v2;
+    r.y1 = y - u2;
+    r.y2 = y - u1;
+  }
+  else if (angle == 2) {
+    // 180°: the text runs to the left, lines follow upwards
+    r.x1 = x - u2;
+    r.x2 = x - u1;
+    r.y1 = y - v2;
+    r.y2 = y;
+  }
+  else if (angle == 3) {
+    // 270°: the text runs downwards, lines follow to the left
+    r.x1 = x - v2;
+    r.x2 = x;
+    r.y1 = y + u1;
+    r.y2 = y + u2;
+  }
+  else {
+    r.x1 = x + u1;
+    r.x2 = x + u2;
+    r.y1 = y;
+    r.y2 = y + v2;
+  }
+  return r;
+}
+
+
+size_t EDIPFont::fit(const char* text, unsigned int width) {
+  const char* p = text;
+  const char* next;
+  unsigned int used = 0;
+  unsigned char w;
+  boolean lineEnd;
+
+  while (*p) {
+    next = p;
+    w = glyph(next, lineEnd);
+    if (lineEnd || used + w > width) {
+      break;
+    }
+    used += w;
+    p = next;
+  }
+  return p - text;
+}
+
+
+boolean EDIPFont::wrap(const char* text, unsigned int width, char* out,
+                       size_t size) {
+  size_t n = 0, len, space = 0;
+  unsigned int line = 0;
+  const char* next;
+  unsigned char w;
+  boolean lineEnd;
+
+  if (size == 0) {
+    return false;
+  }
+  out[0] = 0;
+  while (*text) {
+    next = text;
+    w = glyph(next, lineEnd);
+    len = next - text;
+    if (lineEnd) {
+      line = 0;
+      space = 0;
+    }
+    else if (line + w > width && line > 0) {
+      if (*text == ' ') {
+        // the space becomes the line break
+        if (n + 1 >= size) {
+          return false;
+        }
+        out[n++] = '|';
+        out[n] = 0;
+        line = 0;
+        space = 0;
+        text = next;
+        continue;
+      }
+      if (space > 0) {
+        // break at the last space, the word moves to the next line
+        out[space - 1] = '|';
+        line = lineWidth(out + space);
+        space = 0;
+      }
+      if (line + w > width && line > 0) {
+        if (n + 1 >= size) {
+          return false;
+        }
+        out[n++] = '|';
+        out[n] = 0;
+        line = 0;
+      }
+    }
+    if (n + len >= size) {
+      return false;
+    }
+    memcpy(out + n, text, len);
+    n += len;
+    out[n] = 0;
+    if (*text == ' ') {
+      space = n;
+    }
+    line += w;
+    text = next;
+  }
+  return true;
+}
@@ -0,0 +1,119 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPFont_h
+#define EDIPFont_h
+
+#include "EDIPTFT.h"
+
+/*! \brief Rectangle in display pixels, corners included
+ *
+ * x2 < x1 for an empty text.
+ */
+struct EDIPRect {
+  int x1;
+  int y1;
+  int x2;
+  int y2;
+};
+
+/*! \brief Size of text in one of the display fonts
+ *
+ * Measures text the way drawText() puts it on the screen: `|` starts a
+ * new line, `~` and `@` (flashing) take no space and `\\` draws the next
+ * character as it is. With bounds() only the area of the old text needs
+ * to be cleared before new text is drawn:
+ *
+ *     EDIPFont font(EA_FONT7X12);
+ *     EDIPRect r = font.bounds(100, 30, 'C', oldText);
+ *     tft.clearRect(r.x1, r.y1, r.x2, r.y2);
+ *     tft.drawText(100, 30, 'C', newText);
+ *
+ * The monospaced fonts (EA_FONT8X8 to EA_FONT7X12) are exact. For the
+ * proportional fonts (EA_GENEVA10 to EA_BIGZIF57) every character is
+ * counted as wide as the line is high, so bounds() may be larger than the
+ * text but never smaller, and fit() and wrap() leave room to spare.
+ */
+class EDIPFont {
+  public:
+    /*! \brief Metrics of built-in font \a font (`EA_FONT8X8` ...)
+     *
+     * Unknown font numbers get the metrics of EA_FONT8X8.
+     */
+    EDIPFont(char font);
+
+    /*! \brief Metrics of a monospaced font loaded into the display
+     */
+    EDIPFont(unsigned char width, unsigned char height);
+
+    /*! \brief Height of a line in pixels
+     */
+    unsigned char height();
+
+    /*! \brief Width of character \a c in pixels
+     */
+    unsigned char charWidth(char c);
+
+    /*! \brief Width of the first line of \a text in pixels
+     */
+    unsigned int lineWidth(const char* text);
+
+    /*! \brief Width of the widest line of \a text in pixels
+     */
+    unsigned int textWidth(const char* text);
+
+    /*! \brief Number of lines in \a text
+     */
+    unsigned char lines(const char* text);
+
+    /*! \brief Area drawText() covers
+     *
+     * \param x, y, justification, text as for drawText()
+     * \param angle as for setTextAngle(): 0 to 3 for 0°, 90°, 180° and
+     *              270°; at 90° the text reads from bottom to top
+     */
+    EDIPRect bounds(int x, int y, char justification, const char* text,
+                    char angle=0);
+
+    /*! \brief Number of bytes of the first line of \a text that fit into
+     *         \a width pixels, to truncate text
+     */
+    size_t fit(const char* text, unsigned int width);
+
+    /*! \brief Copy \a text to \a out with line breaks so that every line
+     *         fits into \a width pixels
+     *
+     * Lines are broken at spaces, words that are too long at any
+     * character.
+     *
+     * \return false if \a out (\a size bytes) is too small
+     */
+    boolean wrap(const char* text, unsigned int width, char* out,
+                 size_t size);
+
+  private:
+    unsigned char _width;
+    unsigned char _height;
+    unsigned char glyph(const char*& text, boolean& lineEnd);
+};
+#endif
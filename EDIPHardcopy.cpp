@@ -0,0 +1,248 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPHardcopy.h"
+
+#define STATE_IDLE 0
+#define STATE_COMMAND 1
+#define STATE_LEN 2
+#define STATE_DATA 3
+
+// BMP header fields
+#define BMP_OFFSET 10
+#define BMP_WIDTH 18
+#define BMP_HEIGHT 22
+#define BMP_BPP 28
+#define BMP_COMPRESSION 30
+#define BMP_HEADER_END 34
+
+// compression of 16 bit images with RGB565 masks
+#define BMP_BITFIELDS 3
+
+
+EDIPHardcopy::EDIPHardcopy() {
+  _sink = 0;
+  _events = 0;
+  _done = true;
+  _error = EDIP_OK;
+  _state = STATE_IDLE;
+}
+
+
+char EDIPHardcopy::read(EDIPTFT& tft, int x1, int y1, int x2, int y2,
+                        EDIPPixelSink& sink, EDIPEvents* events) {
+  char data[EDIPTFT_RX_SIZE];
+  unsigned long start;
+  int len;
+  char result;
+
+  begin(sink, events);
+  result = tft.requestHardcopy(x1, y1, x2, y2);
+  if (result != EDIP_OK) {
+    return result;
+  }
+  start = millis();
+  while (!_done) {
+    len = tft.readBuffer(data, sizeof(data));
+    if (len < 0) {
+      return len;
+    }
+    if (len > 0) {
+      feed(data, len);
+      start = millis();
+    }
+    else if (millis() - start >= EDIPHARDCOPY_TIMEOUT) {
+      return EDIP_ERR_TIMEOUT;
+    }
+  }
+  return _error;
+}
+
+
+void EDIPHardcopy::begin(EDIPPixelSink& sink, EDIPEvents* events) {
+  _sink = &sink;
+  _events = events;
+  _state = STATE_IDLE;
+  _filePos = 0;
+  _offset = 0;
+  _width = 0;
+  _height = 0;
+  _bpp = 0;
+  _compression = 0;
+  _rowPos = 0;
+  _row = 0;
+  _done = false;
+  _error = EDIP_OK;
+}
+
+
+void EDIPHardcopy::feed(const char* data, int len) {
+  int i;
+  unsigned char c;
+
+  for (i = 0; i < len; i++) {
+    c = data[i];
+    switch (_state) {
+      case STATE_IDLE:
+        if (c == ESC) {
+          _state = STATE_COMMAND;
+        }
+        break;
+
+      case STATE_COMMAND:
+        _command = c;
+        _state = STATE_LEN;
+        if (_command != 'U') {
+          forward(ESC);
+          forward(c);
+        }
+        break;
+
+      case STATE_LEN:
+        _len = c;
+        _pos = 0;
+        _state = _len ? STATE_DATA : STATE_IDLE;
+        if (_command != 'U') {
+          forward(c);
+        }
+        break;
+
+      case STATE_DATA:
+        if (_command == 'U') {
+          image(c);
+        }
+        else {
+          forward(c);
+        }
+        if (++_pos == _len) {
+          _state = STATE_IDLE;
+        }
+        break;
+    }
+  }
+}
+
+
+boolean EDIPHardcopy::done() {
+  return _done;
+}
+
+
+char EDIPHardcopy::error() {
+  return _error;
+}
+
+
+void EDIPHardcopy::forward(char c) {
+  if (_events) {
+    _events->feed(c);
+  }
+}
+
+
+void EDIPHardcopy::image(unsigned char c) {
+  if (_done) {
+    return;
+  }
+  if (_filePos < BMP_HEADER_END) {
+    header(c);
+  }
+  else if (_filePos >= _offset) {
+    // pixel data, rows padded to 4 bytes
+    if (_rowPos < (unsigned long)_width * (_bpp / 8)) {
+      _pixel[_rowPos % (_bpp / 8)] = c;
+      if (_rowPos % (_bpp / 8) == _bpp / 8 - 1) {
+        pixel();
+      }
+    }
+    if (++_rowPos == _rowSize) {
+      _rowPos = 0;
+      if (++_row == labs(_height)) {
+        _done = true;
+      }
+    }
+  }
+  _filePos++;
+}
+
+
+void EDIPHardcopy::header(unsigned char c) {
+  unsigned long v = c;
+
+  if (_filePos < 2) {
+    if (c != (_filePos == 0 ? 'B' : 'M')) {
+      _error = EDIP_ERR_IMAGE;
+      _done = true;
+    }
+  }
+  else if (_filePos >= BMP_OFFSET && _filePos < BMP_OFFSET + 4) {
+    _offset |= v << (8 * (_filePos - BMP_OFFSET));
+  }
+  else if (_filePos >= BMP_WIDTH && _filePos < BMP_WIDTH + 4) {
+    _width |= v << (8 * (_filePos - BMP_WIDTH));
+  }
+  else if (_filePos >= BMP_HEIGHT && _filePos < BMP_HEIGHT + 4) {
+    _height |= v << (8 * (_filePos - BMP_HEIGHT));
+  }
+  else if (_filePos >= BMP_BPP && _filePos < BMP_BPP + 2) {
+    _bpp |= v << (8 * (_filePos - BMP_BPP));
+  }
+  else if (_filePos >= BMP_COMPRESSION && _filePos < BMP_COMPRESSION + 4) {
+    _compression |= v << (8 * (_filePos - BMP_COMPRESSION));
+  }
+
+  if (_filePos == BMP_HEADER_END - 1) {
+    // the fields are signed 32 bit, a negative height means top-down rows
+    _width = (int32_t)(uint32_t)_width;
+    _height = (int32_t)(uint32_t)_height;
+    if ((_bpp != 16 && _bpp != 24 && _bpp != 32) || _width <= 0 ||
+        _height == 0 || _offset < BMP_HEADER_END) {
+      _error = EDIP_ERR_IMAGE;
+      _done = true;
+      return;
+    }
+    _rowSize = ((unsigned long)_width * _bpp / 8 + 3) & ~3UL;
+    _sink->begin(_width, labs(_height));
+  }
+}
+
+
+void EDIPHardcopy::pixel() {
+  int x = _rowPos / (_bpp / 8);
+  // rows are stored bottom-up unless the height is negative
+  int y = _height > 0 ? _height - 1 - _row : _row;
+  unsigned int v;
+
+  if (_bpp == 16) {
+    v = _pixel[0] | (_pixel[1] << 8);
+    if (_compression == BMP_BITFIELDS) {
+      _sink->pixel(x, y, (v >> 8) & 0xf8, (v >> 3) & 0xfc, (v << 3) & 0xf8);
+    }
+    else {
+      _sink->pixel(x, y, (v >> 7) & 0xf8, (v >> 2) & 0xf8, (v << 3) & 0xf8);
+    }
+  }
+  else {
+    _sink->pixel(x, y, _pixel[2], _pixel[1], _pixel[0]);
+  }
+}
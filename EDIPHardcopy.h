@@ -0,0 +1,117 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPHardcopy_h
+#define EDIPHardcopy_h
+
+#include "EDIPTFT.h"
+#include "EDIPEvents.h"
+
+// Time without new data after which read() gives up (ms)
+#ifndef EDIPHARDCOPY_TIMEOUT
+#define EDIPHARDCOPY_TIMEOUT 1000
+#endif
+
+/*! \brief Receives the pixels of a hardcopy
+ */
+class EDIPPixelSink {
+  public:
+    virtual ~EDIPPixelSink() {}
+
+    /*! \brief Called once the size of the image is known
+     */
+    virtual void begin(int /*width*/, int /*height*/) {}
+
+    /*! \brief Called for every pixel, \a x and \a y relative to the area
+     */
+    virtual void pixel(int x, int y, unsigned char r, unsigned char g,
+                       unsigned char b) = 0;
+};
+
+/*! \brief Screen readback
+ *
+ * Decodes the hardcopy the display sends for
+ * EDIPTFT::requestHardcopy() while it arrives: the send buffer records
+ * `ESC U len data` carry a BMP file (16, 24 or 32 bits per pixel) whose
+ * pixels are passed to an EDIPPixelSink one by one, so no memory for the
+ * image is needed.
+ *
+ *     EDIPHardcopy hardcopy;
+ *     hardcopy.read(tft, 0, 0, 99, 49, sink);
+ */
+class EDIPHardcopy {
+  public:
+    EDIPHardcopy();
+
+    /*! \brief Request and read a hardcopy
+     *
+     * Blocks until the image is complete. Other responses that arrive
+     * meanwhile (touch keys, ...) go to \a events if given.
+     *
+     * \return `EDIP_OK`, `EDIP_ERR_IMAGE` for an unsupported image,
+     *         `EDIP_ERR_TIMEOUT` or error code of the request
+     */
+    char read(EDIPTFT& tft, int x1, int y1, int x2, int y2,
+              EDIPPixelSink& sink, EDIPEvents* events=0);
+
+    /*! \brief Start decoding a new hardcopy into \a sink
+     */
+    void begin(EDIPPixelSink& sink, EDIPEvents* events=0);
+
+    /*! \brief Decode \a len bytes read from the send buffer
+     */
+    void feed(const char* data, int len);
+
+    /*! \brief true when the image is complete (or unusable)
+     */
+    boolean done();
+
+    /*! \brief `EDIP_OK` or `EDIP_ERR_IMAGE`
+     */
+    char error();
+
+  private:
+    EDIPPixelSink* _sink;
+    EDIPEvents* _events;
+    unsigned char _state;
+    char _command;
+    unsigned char _len;
+    unsigned char _pos;
+    unsigned long _filePos;
+    unsigned long _offset;
+    long _width;
+    long _height;
+    unsigned int _bpp;
+    unsigned long _compression;
+    unsigned long _rowSize;
+    unsigned long _rowPos;
+    long _row;
+    unsigned char _pixel[4];
+    boolean _done;
+    char _error;
+    void forward(char c);
+    void image(unsigned char c);
+    void header(unsigned char c);
+    void pixel();
+};
+#endif
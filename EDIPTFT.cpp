@@ -21,726 +21,1875 @@
 //      Boston, MA 02110-1301 USA
 //
 
-#include <ediptft.h>
-#define DEBUG false
+#include "EDIPTFT.h"
+
+// Shadow state: offset of every display state value in the cache
+#define SHADOW_DISPLAYCOLOR 0   // fg, bg
+#define SHADOW_TEXTCOLOR 2      // fg, bg
+#define SHADOW_TEXTFONT 4
+#define SHADOW_TEXTANGLE 5
+#define SHADOW_LINECOLOR 6      // fg, bg
+#define SHADOW_LINETHICK 8      // x, y
+#define SHADOW_TOUCHCOLORS 10   // n1, n2, n3, s1, s2, s3
+#define SHADOW_TOUCHFONT 16
+#define SHADOW_TOUCHLABEL 17    // nf, sf
+#define SHADOW_TOUCHGROUP 19
+#define SHADOW_MENUFONT 20
+
+// Baud rates in the order of their codes for DC2 B (code = index + 1)
+static const long baudRates [] = {
+  1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400
+};
+#define BAUD_RATES (sizeof(baudRates) / sizeof(baudRates[0]))
+
+// BMP file header: "BM", file size (4 bytes)
+#define BMP_HEADER_SIZE 6
+
+// Shapes held back by the geometry coalescer
+#define SHAPE_FILL 0    // ESC R S, line color
+#define SHAPE_CLEAR 1   // ESC R L
+#define SHAPE_FILLC 2   // ESC R F, own color
+#define SHAPE_LINE 3    // ESC G D
+
+// Offset of the data in a DC1 or DC2 frame, bytes around it
+#define FRAME_DATA 2
+#define FRAME_OVERHEAD 3
+
+// Largest DC2 request frame the library sends
+#define DC2_FRAME_SIZE 8
+
+// Statistics code disappears without EDIPTFT_STATS
+#ifdef EDIPTFT_STATS
+#define STAT(statement) statement
+#else
+#define STAT(statement)
+#endif
+
+// Receive framer states
+#define RX_IDLE 0
+#define RX_LEN 1
+#define RX_DATA 2
+#define RX_BCC 3
+
+
+#ifndef EDIPTFT_NO_SERIAL_DEV
+static EDIPSerialTransport<decltype(SERIAL_DEV)> serialDev(SERIAL_DEV);
 
 
 EDIPTFT::EDIPTFT(boolean smallprotocol) {
+  _transport = &serialDev;
+  init(smallprotocol, COORD_SIZE);
+}
+#endif
+
+
+EDIPTFT::EDIPTFT(EDIPTransport& transport, boolean smallprotocol,
+                 unsigned char coordSize) {
+  _transport = &transport;
+  init(smallprotocol, coordSize);
+}
+
+
+void EDIPTFT::init(boolean smallprotocol, unsigned char coordSize) {
   _smallprotocol = smallprotocol;
+  _coordSize = coordSize;
+  _baud = 0;
+  _packetSize = EDIPTFT_PACKET_SIZE;
+  _batching = false;
+  _batchTimeout = 0;
+  _batchStart = 0;
+  _packetLen = 0;
+  _async = false;
+  _txHead = 0;
+  _txCount = 0;
+  _txWaiting = false;
+  _txNextSeq = 0;
+  memset(_txStatus, EDIP_UNKNOWN, sizeof(_txStatus));
+  _txBackoff = false;
+  _txTries = 0;
+  _txSentAt = 0;
+  _txResendAt = 0;
+  _txFailed = 0;
+  _cmdFailed = 0;
+  _recBuffer = 0;
+  _recSize = 0;
+  _recLen = 0;
+  _recOverflow = false;
+  _geoEnabled = false;
+  _geoCount = 0;
+  STAT(resetStats());
+  _shadowEnabled = false;
+  _shadowValid = 0;
+  _valueInterval = 0;
+  _rxState = RX_IDLE;
+  _rxExpect = 0;
+  _rxExpectAck = false;
+  _rxAck = 0;
+  _rxLast = 0;
+  _valuesSent = 0;
+  _barDirty = 0;
+  _barKnown = 0;
+  _instDirty = 0;
+  _instKnown = 0;
+  _lastError = EDIP_OK;
+  _ackTimeout = EDIPTFT_ACK_TIMEOUT;
+  _maxRetries = EDIPTFT_RETRIES;
+  _retryDelay = EDIPTFT_RETRY_DELAY;
+}
+
+
+unsigned char EDIPTFT::coordSize() {
+  return _coordSize;
+}
+
+
+char* EDIPTFT::putCoord(char* p, int value) {
+  *p++ = lowByte(value);
+  if (_coordSize == 2) {
+    *p++ = highByte(value);
+  }
+  return p;
+}
+
+
+char* EDIPTFT::putPoint(char* p, int x, int y) {
+  p = putCoord(p, x);
+  return putCoord(p, y);
+}
+
+
+char* EDIPTFT::putRect(char* p, int x1, int y1, int x2, int y2) {
+  p = putPoint(p, x1, y1);
+  return putPoint(p, x2, y2);
 }
 
 
 void EDIPTFT::begin(long baud) {
-    SERIAL_DEV.begin(baud);
+    _transport->begin(baud);
+    _baud = baud;
+}
+
+
+char EDIPTFT::negotiate(long maxBaud) {
+  EDIPProtocolInfo info;
+  char result;
+  int i;
+
+  result = protocolInfo(info);
+  if (result != EDIP_OK) {
+    return result;
+  }
+  // protocolInfo() waited for the queue, no packet is open
+  _packetSize = EDIPTFT_PACKET_SIZE;
+  if (info.maxPacketSize != 0 && info.maxPacketSize < _packetSize) {
+    _packetSize = info.maxPacketSize;
+  }
+  if (info.sendPacketSize > EDIPTFT_RX_SIZE) {
+    // longer responses would overflow the receive buffer
+    result = setProtocol(EDIPTFT_RX_SIZE, info.timeout);
+    if (result != EDIP_OK) {
+      return result;
+    }
+  }
+
+  for (i = BAUD_RATES - 1; i >= 0 && baudRates[i] > _baud; i--) {
+    if (baudRates[i] <= maxBaud && setBaudRate(baudRates[i]) == EDIP_OK) {
+      break;
+    }
+  }
+  return EDIP_OK;
+}
+
+
+char EDIPTFT::protocolInfo(EDIPProtocolInfo& info) {
+  int result;
+  char command [] = {
+    0x01, 'P'
+  };
+  result = request(command, sizeof(command), DC2);
+  if (result < 0) {
+    return result;
+  }
+  if (result < 3) {
+    return _lastError = EDIP_ERR_CHECKSUM;
+  }
+  info.maxPacketSize = _rxData[0];
+  info.sendPacketSize = _rxData[1];
+  info.timeout = _rxData[2];
+  return EDIP_OK;
+}
+
+
+char EDIPTFT::setProtocol(unsigned char sendPacketSize, unsigned char timeout) {
+  char command [] = {
+    0x03, 'D', (char)sendPacketSize, (char)timeout
+  };
+  return sendSmallDC2(command, sizeof(command));
+}
+
+
+char EDIPTFT::baudCode(long baud) {
+  unsigned char i;
+  for (i = 0; i < BAUD_RATES; i++) {
+    if (baudRates[i] == baud) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+
+char EDIPTFT::setBaudRate(long baud) {
+  EDIPProtocolInfo info;
+  long old = _baud;
+  char result, check;
+  char command [] = {
+    0x02, 'B', baudCode(baud)
+  };
+
+  if (command[2] == 0) {
+    return EDIP_ERR_BAUD;
+  }
+  result = sendSmallDC2(command, sizeof(command));
+  if (result != EDIP_OK) {
+    // the display did not take the command and stays at the old rate
+    return result;
+  }
+  // the display switches after its ACK
+  _transport->begin(baud);
+  _baud = baud;
+  check = checkLink();
+  if (check == EDIP_OK || old == 0) {
+    return check;
+  }
+
+  // the line does not work at the new rate, go back as far as the
+  // display still understands us
+  command[2] = baudCode(old);
+  if (command[2] != 0) {
+    sendSmallDC2(command, sizeof(command));
+  }
+  _transport->begin(old);
+  _baud = old;
+  result = protocolInfo(info);
+  return result == EDIP_OK ? check : result;
+}
+
+
+char EDIPTFT::checkLink() {
+  EDIPProtocolInfo info;
+  unsigned char retries = _maxRetries;
+  unsigned char i;
+  char result = EDIP_OK;
+
+  // a rate that needs retries is not good enough
+  _maxRetries = 0;
+  for (i = 0; i < EDIPTFT_BAUD_CHECKS && result == EDIP_OK; i++) {
+    result = protocolInfo(info);
+  }
+  _maxRetries = retries;
+  return result;
+}
+
+
+long EDIPTFT::baudRate() {
+  return _baud;
+}
+
+
+unsigned char EDIPTFT::packetSize() {
+  return _packetSize;
 }
 
 
 void EDIPTFT::sendByte(char data) {
-  SERIAL_DEV.write(data);
+  _transport->write(&data, 1);
+  STAT(_stats.bytesSent++);
 }
 
 
 char EDIPTFT::readByte() {
-  return SERIAL_DEV.read();
+  return _transport->read();
 }
 
 
-void EDIPTFT::waitBytesAvailable() {
+boolean EDIPTFT::waitBytesAvailable() {
+  unsigned long start = millis();
   while (bytesAvailable() == 0) {
+    if (millis() - start >= _ackTimeout) {
+      return false;
+    }
   }
+  return true;
 }
 
 
-char EDIPTFT::waitandreadByte() {
-  waitBytesAvailable();
-  char result = readByte();
-  return(result);
+int EDIPTFT::waitandreadByte() {
+  if (!waitBytesAvailable()) {
+    return -1;
+  }
+  return (unsigned char)readByte();
 }
 
 
 unsigned char EDIPTFT::bytesAvailable() {
-    return SERIAL_DEV.available();
+    return _transport->available();
+}
+
+
+char EDIPTFT::sendData(char* data, char len) {
+  beginCommand();
+  putData(data, len);
+  return endCommand();
+}
+
+
+void EDIPTFT::beginCommand() {
+  _cmdFailed = _txFailed;
+  if (_geoCount) {
+    putGeometry();
+  }
+}
+
+
+void EDIPTFT::put(char c) {
+  if (_recBuffer) {
+    putData(&c, 1);
+    return;
+  }
+  if (!_smallprotocol) {
+    sendByte(c);
+    return;
+  }
+  if (_packetLen == 0) {
+    openPacket();
+  }
+  _txData[txTail()][FRAME_DATA + _packetLen++] = c;
+  _packetBcc += c;
+  if (_packetLen == _packetSize) {
+    flush();
+  }
+}
+
+
+void EDIPTFT::putData(const char* data, size_t len) {
+  size_t chunk;
+  char* frame;
+
+  if (_recBuffer) {
+    if (_recOverflow || len > _recSize - _recLen) {
+      _recOverflow = true;
+      return;
+    }
+    memcpy(_recBuffer + _recLen, data, len);
+    _recLen += len;
+    return;
+  }
+  if (!_smallprotocol) {
+    _transport->write(data, len);
+    STAT(_stats.bytesSent += len);
+    return;
+  }
+  while (len > 0) {
+    if (_packetLen == 0) {
+      openPacket();
+    }
+    chunk = _packetSize - _packetLen;
+    if (chunk > len) {
+      chunk = len;
+    }
+    // copy and checksum in one pass
+    frame = _txData[txTail()] + FRAME_DATA + _packetLen;
+    _packetLen += chunk;
+    len -= chunk;
+    while (chunk-- > 0) {
+      _packetBcc += *data;
+      *frame++ = *data++;
+    }
+    if (_packetLen == _packetSize) {
+      flush();
+    }
+  }
+}
+
+
+void EDIPTFT::putText(const char* text) {
+  // the string and its terminating NUL go straight into the packet(s)
+  putData(text, strlen(text) + 1);
+}
+
+
+void EDIPTFT::openPacket() {
+  // the open packet is assembled in the slot behind the queue
+  while (_txCount == EDIPTFT_TX_SLOTS) {
+    serviceTx();
+  }
+  _packetBcc = DC1;
+  _batchStart = millis();
+}
+
+
+char EDIPTFT::endCommand() {
+  char result;
+
+  if (!_smallprotocol && !_recBuffer) {
+    result = _transport->commandDone();
+    if (result != EDIP_OK) {
+      _lastError = result;
+      return result;
+    }
+  }
+  if (_smallprotocol && (!_batching ||
+      (_batchTimeout && millis() - _batchStart >= _batchTimeout))) {
+    flush();
+  }
+  // in async mode failures show up later in packetStatus()/lastError()
+  return _txFailed != _cmdFailed ? _lastError : EDIP_OK;
+}
+
+
+void EDIPTFT::setBatching(boolean on, unsigned int timeout) {
+  if (!on) {
+    flush();
+  }
+  _batching = on;
+  _batchTimeout = timeout;
+}
+
+
+void EDIPTFT::setAsync(boolean on) {
+  if (!on) {
+    waitTxIdle();
+  }
+  _async = on;
+}
+
+
+void EDIPTFT::setTimeouts(unsigned int ackTimeout, unsigned char retries,
+                          unsigned int retryDelay) {
+  _ackTimeout = ackTimeout;
+  _maxRetries = retries;
+  _retryDelay = retryDelay;
+}
+
+
+char EDIPTFT::lastError() {
+  return _lastError;
 }
 
 
-void EDIPTFT::sendData(char* data, char len) {
-  if (DEBUG) {
-    unsigned char i;
-    for (i = 0; i < len; i++) {
-      SERIAL_DEV.print(byte(data[i]), HEX);
-      SERIAL_DEV.print(" ");
+char EDIPTFT::flush() {
+  unsigned int failed = _txFailed;
+  if (_geoCount) {
+    putGeometry();
+  }
+  if (_packetLen == 0) {
+    return EDIP_OK;
+  }
+  unsigned char slot = txTail();
+  if (++_txNextSeq == 0) {
+    _txNextSeq = 1;
+  }
+  _txSeq[slot] = _txNextSeq;
+  _txLen[slot] = _packetLen;
+  _txData[slot][0] = DC1;
+  _txData[slot][1] = _packetLen;
+  _txData[slot][FRAME_DATA + _packetLen] = _packetBcc + _packetLen;
+  _txStatus[_txNextSeq % EDIPTFT_TX_HISTORY] = EDIP_QUEUED;
+  _txCount++;
+  _packetLen = 0;
+
+  if (_async) {
+    serviceTx();
+  }
+  else {
+    waitTxIdle();
+  }
+  return _txFailed != failed ? _lastError : EDIP_OK;
+}
+
+
+void EDIPTFT::poll() {
+  receive();
+  if (_geoCount) {
+    // beginCommand() sends the held back shapes
+    beginCommand();
+    endCommand();
+  }
+  if (_barDirty || _instDirty) {
+    flushValuesIfDue();
+  }
+  if (_packetLen > 0 && _batchTimeout &&
+      millis() - _batchStart >= _batchTimeout) {
+    flush();
+  }
+  serviceTx();
+}
+
+
+void EDIPTFT::beginRecording(char* buffer, unsigned int size) {
+  // commands buffered so far are not part of the recording
+  flush();
+  _recBuffer = buffer;
+  _recSize = size;
+  _recLen = 0;
+  _recOverflow = false;
+}
+
+
+int EDIPTFT::endRecording() {
+  if (_geoCount) {
+    putGeometry();
+  }
+  _recBuffer = 0;
+  return _recOverflow ? EDIP_ERR_OVERFLOW : _recLen;
+}
+
+
+unsigned int EDIPTFT::recordedBytes() {
+  // queued shapes were drawn before, they belong in front of the next command
+  if (_recBuffer && _geoCount) {
+    putGeometry();
+  }
+  return _recLen;
+}
+
+
+char EDIPTFT::sendCommands(const char* data, unsigned int len) {
+  invalidateState();
+  beginCommand();
+  putData(data, len);
+  return endCommand();
+}
+
+
+void EDIPTFT::setGeometryCoalescing(boolean on) {
+  if (!on && _geoCount) {
+    beginCommand();
+    endCommand();
+  }
+  _geoEnabled = on;
+}
+
+
+boolean EDIPTFT::queueShape(unsigned char kind, int x1, int y1, int x2,
+                            int y2, char color) {
+  Shape shape;
+  unsigned char i, n;
+
+  if (!_geoEnabled) {
+    return false;
+  }
+  if (kind != SHAPE_LINE) {
+    // rectangles are compared with x1 <= x2, y1 <= y2
+    shape.x1 = min(x1, x2);
+    shape.x2 = max(x1, x2);
+    shape.y1 = min(y1, y2);
+    shape.y2 = max(y1, y2);
+  }
+  else {
+    shape.x1 = x1;
+    shape.y1 = y1;
+    shape.x2 = x2;
+    shape.y2 = y2;
+  }
+  shape.kind = kind;
+  shape.color = color;
+
+  // only the last shape is merged, nothing lies between the two
+  if (_geoCount && mergeShape(_geo[_geoCount - 1], shape)) {
+    shape = _geo[--_geoCount];
+  }
+  if (kind != SHAPE_LINE) {
+    for (i = 0, n = 0; i < _geoCount; i++) {
+      if (!covers(shape, _geo[i])) {
+        _geo[n++] = _geo[i];
+      }
+    }
+    _geoCount = n;
+  }
+  if (_geoCount == EDIPTFT_GEOMETRY_QUEUE) {
+    beginCommand();
+    endCommand();
+  }
+  _geo[_geoCount++] = shape;
+  return true;
+}
+
+
+boolean EDIPTFT::mergeShape(Shape& a, const Shape& b) {
+  int adx, ady, bdx, bdy, lo, hi;
+
+  if (a.kind != b.kind || a.color != b.color) {
+    return false;
+  }
+  if (a.kind != SHAPE_LINE) {
+    if (b.x1 >= a.x1 && b.x2 <= a.x2 && b.y1 >= a.y1 && b.y2 <= a.y2) {
+      return true;
+    }
+    if (a.y1 == b.y1 && a.y2 == b.y2 && b.x1 <= a.x2 + 1 && b.x2 >= a.x1 - 1) {
+      a.x1 = min(a.x1, b.x1);
+      a.x2 = max(a.x2, b.x2);
+      return true;
+    }
+    if (a.x1 == b.x1 && a.x2 == b.x2 && b.y1 <= a.y2 + 1 && b.y2 >= a.y1 - 1) {
+      a.y1 = min(a.y1, b.y1);
+      a.y2 = max(a.y2, b.y2);
+      return true;
+    }
+    return false;
+  }
+
+  adx = a.x2 - a.x1;
+  ady = a.y2 - a.y1;
+  bdx = b.x2 - b.x1;
+  bdy = b.y2 - b.y1;
+  if (ady == 0 && bdy == 0 && a.y1 == b.y1) {
+    lo = min(min(a.x1, a.x2), min(b.x1, b.x2));
+    hi = max(max(a.x1, a.x2), max(b.x1, b.x2));
+    // joined only if there is no gap between the two
+    if (hi - lo <= abs(adx) + abs(bdx) + 1) {
+      a.x1 = lo;
+      a.x2 = hi;
+      return true;
+    }
+  }
+  if (adx == 0 && bdx == 0 && a.x1 == b.x1) {
+    lo = min(min(a.y1, a.y2), min(b.y1, b.y2));
+    hi = max(max(a.y1, a.y2), max(b.y1, b.y2));
+    if (hi - lo <= abs(ady) + abs(bdy) + 1) {
+      a.y1 = lo;
+      a.y2 = hi;
+      return true;
     }
-    SERIAL_DEV.println();
   }
+  // 45 degree lines have the same pixels whether drawn in one or two parts
+  if (adx != 0 && abs(adx) == abs(ady) && abs(bdx) == abs(bdy) &&
+      (adx > 0) == (bdx > 0) && (ady > 0) == (bdy > 0) && bdx != 0 &&
+      b.x1 == a.x2 && b.y1 == a.y2) {
+    a.x2 = b.x2;
+    a.y2 = b.y2;
+    return true;
+  }
+  return false;
+}
+
+
+boolean EDIPTFT::covers(const Shape& a, const Shape& b) {
+  int margin = 0;
+
+  if (b.kind == SHAPE_LINE) {
+    // thick lines reach beyond their end points
+    if (_recBuffer || !(_shadowValid & (1UL << SHADOW_LINETHICK))) {
+      margin = 15;
+    }
+    else {
+      margin = max(_shadow[SHADOW_LINETHICK], _shadow[SHADOW_LINETHICK + 1]);
+    }
+  }
+  return a.x1 <= min(b.x1, b.x2) - margin && a.x2 >= max(b.x1, b.x2) + margin &&
+         a.y1 <= min(b.y1, b.y2) - margin && a.y2 >= max(b.y1, b.y2) + margin;
+}
+
+
+void EDIPTFT::putGeometry() {
+  static const char codes [][2] = {
+    {'R', 'S'}, {'R', 'L'}, {'R', 'F'}, {'G', 'D'}
+  };
+  unsigned char i, n = _geoCount;
+  char command [4 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27
+  };
+  char* end;
+
+  // putData() may flush(), which must not send the queue again
+  _geoCount = 0;
+  for (i = 0; i < n; i++) {
+    command[1] = codes[_geo[i].kind][0];
+    command[2] = codes[_geo[i].kind][1];
+    end = putRect(command + 3, _geo[i].x1, _geo[i].y1, _geo[i].x2, _geo[i].y2);
+    if (_geo[i].kind == SHAPE_FILLC) {
+      *end++ = _geo[i].color;
+    }
+    putData(command, end - command);
+  }
+}
+
+
+#ifdef EDIPTFT_STATS
+// Family of the first command in a packet
+static unsigned char commandFamily(const char* data, unsigned char len) {
+  if (len < 2 || data[0] != ESC) {
+    // terminal output
+    return EDIP_FAMILY_TEXT;
+  }
+  switch (data[1]) {
+    case 'Z':
+    case 'T':
+      return EDIP_FAMILY_TEXT;
+    case 'D':
+    case 'G':
+    case 'R':
+    case 'U':
+      return EDIP_FAMILY_GEOMETRY;
+    case 'B':
+    case 'I':
+      return EDIP_FAMILY_BARGRAPH;
+    case 'A':
+    case 'H':
+      return EDIP_FAMILY_TOUCH;
+  }
+  return EDIP_FAMILY_OTHER;
+}
+
+
+const EDIPStats& EDIPTFT::stats() {
+  return _stats;
+}
+
+
+void EDIPTFT::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+
+void EDIPTFT::countLatency(unsigned char family) {
+  unsigned long ms = (micros() - _statSentAt) / 1000;
+  unsigned char bin = 0;
+
+  while (ms > 0 && bin < EDIP_LATENCY_BINS - 1) {
+    ms >>= 1;
+    bin++;
+  }
+  _stats.latency[family][bin]++;
+}
+#endif
+
+
+unsigned int EDIPTFT::lastPacket() {
+  // a partially filled batch will get the next sequence number
+  return _packetLen > 0 ? _txNextSeq + 1 : _txNextSeq;
+}
+
 
-  if (_smallprotocol) {
-    sendSmall(data, len);
+unsigned char EDIPTFT::packetStatus(unsigned int packet) {
+  if (packet == 0 || (unsigned int)(_txNextSeq - packet) >= EDIPTFT_TX_HISTORY) {
+    // still being assembled or too old to be remembered
+    return (packet == _txNextSeq + 1 && _packetLen > 0) ? EDIP_QUEUED
+                                                        : EDIP_UNKNOWN;
+  }
+  return _txStatus[packet % EDIPTFT_TX_HISTORY];
+}
+
+
+unsigned char EDIPTFT::pendingPackets() {
+  return _txCount;
+}
+
+
+unsigned char EDIPTFT::txTail() {
+  return (_txHead + _txCount) % EDIPTFT_TX_SLOTS;
+}
+
+
+void EDIPTFT::setStateCache(boolean on) {
+  _shadowEnabled = on;
+  invalidateState();
+}
+
+
+void EDIPTFT::invalidateState() {
+  _shadowValid = 0;
+  _barKnown = 0;
+  _instKnown = 0;
+}
+
+
+boolean EDIPTFT::cached(unsigned char item, const char* values,
+                        unsigned char len) {
+  if (_recBuffer) {
+    // a recording is replayed later, on whatever state the display has
+    return false;
+  }
+  if (_shadowEnabled && (_shadowValid & (1UL << item)) &&
+      memcmp(_shadow + item, values, len) == 0) {
+    return true;
+  }
+  memcpy(_shadow + item, values, len);
+  _shadowValid |= 1UL << item;
+  return false;
+}
+
+
+void EDIPTFT::setUpdateRate(unsigned int interval) {
+  if (interval == 0) {
+    flushValues();
+  }
+  _valueInterval = interval;
+}
+
+
+char EDIPTFT::flushValues() {
+  if (_recBuffer) {
+    // pending values belong to the live screen, not to the recording
+    return EDIP_OK;
+  }
+  beginCommand();
+  putValues('B', _barPending, _barShown, _barDirty, _barKnown,
+            EDIPTFT_BARGRAPHS);
+  putValues('I', _instPending, _instShown, _instDirty, _instKnown,
+            EDIPTFT_INSTRUMENTS);
+  _valuesSent = millis();
+  return endCommand();
+}
+
+
+char EDIPTFT::flushValuesIfDue() {
+  if (millis() - _valuesSent >= _valueInterval) {
+    return flushValues();
+  }
+  return EDIP_OK;
+}
+
+
+void EDIPTFT::coalesce(char* pending, const char* shown, unsigned long& dirty,
+                       unsigned long known, unsigned char i, char val) {
+  unsigned long bit = 1UL << i;
+  pending[i] = val;
+  if ((known & bit) && shown[i] == val) {
+    dirty &= ~bit;
   }
   else {
-    unsigned char i;
-    for(i=0; i < len; i++) {
-      sendByte(data[i]);
+    dirty |= bit;
+  }
+}
+
+
+void EDIPTFT::putValues(char group, const char* pending, char* shown,
+                        unsigned long& dirty, unsigned long& known,
+                        unsigned char count) {
+  unsigned char i;
+  for (i = 0; i < count && dirty; i++) {
+    unsigned long bit = 1UL << i;
+    if (dirty & bit) {
+      char command [] = {
+        27, group, 'A', (char)(i + 1), pending[i]
+      };
+      putData(command, sizeof(command));
+      shown[i] = pending[i];
+      known |= bit;
+      dirty &= ~bit;
     }
   }
 }
 
 
-void EDIPTFT::sendSmall(char* data, char len) {
-  unsigned char i, bcc;
-  char ok = 0;
+void EDIPTFT::forgetValue(unsigned long& mask, unsigned char i) {
+  if (i < 32) {
+    mask &= ~(1UL << i);
+  }
+}
 
-  while (ok == 0) {
-    sendByte(0x11);
-    bcc = 0x11;
 
-    sendByte(len);
-    bcc = bcc + len;
+unsigned int EDIPTFT::retryBackoff(unsigned char tries) {
+  // exponential backoff: retryDelay, 2*retryDelay, 4*retryDelay, ...
+  unsigned long wait = (unsigned long)_retryDelay << (tries > 8 ? 8 : tries);
+  return wait > EDIPTFT_MAX_BACKOFF ? EDIPTFT_MAX_BACKOFF : wait;
+}
+
 
-    for(i=0; i < len; i++) {
-      sendByte(data[i]);
-      bcc = bcc + data[i];
+void EDIPTFT::serviceTx() {
+  char error = EDIP_OK;
+
+  receive();
+  if (_txWaiting) {
+    if (_rxAck == ACK) {
+      STAT(countLatency(commandFamily(_txData[_txHead] + FRAME_DATA,
+                                       _txLen[_txHead])));
+      txDone(EDIP_DONE);
+    }
+    else if (_rxAck == NAK) {
+      STAT(_stats.naks++);
+      error = EDIP_ERR_NAK;
+    }
+    else if (millis() - _txSentAt >= _ackTimeout) {
+      STAT(_stats.timeouts++);
+      error = EDIP_ERR_TIMEOUT;
+    }
+    else {
+      return;
     }
-    sendByte(bcc);
-    waitBytesAvailable();
-    if (bytesAvailable() > 0) {
-      if (readByte() == ACK) ok = 1;
+
+    if (error != EDIP_OK) {
+      _txWaiting = false;
+      if (_txTries > _maxRetries) {
+        _lastError = error;
+        _txFailed++;
+        // the display may have missed state commands in this packet
+        invalidateState();
+        txDone(EDIP_FAILED);
+      }
       else {
-        ok = 0;
+        _txResendAt = millis() + retryBackoff(_txTries - 1);
+        _txBackoff = true;
       }
     }
-    else {
-      delay(2000);
-      ok = 0;
+  }
+
+  if (_txCount == 0 || _txWaiting) {
+    return;
+  }
+  if (_txBackoff) {
+    if ((long)(millis() - _txResendAt) < 0) {
+      return;
+    }
+    _txBackoff = false;
+  }
+  else {
+    _txTries = 0;
+  }
+  STAT(_stats.packets++);
+  STAT(_stats.retries += _txTries > 0);
+  STAT(_statSentAt = micros());
+  expectAck();
+  sendFrame(_txData[_txHead], _txLen[_txHead] + FRAME_OVERHEAD);
+  _txStatus[_txSeq[_txHead] % EDIPTFT_TX_HISTORY] = EDIP_SENT;
+  _txSentAt = millis();
+  _txTries++;
+  _txWaiting = true;
+}
+
+
+void EDIPTFT::txDone(unsigned char status) {
+  _rxAck = 0;
+  _rxExpectAck = false;
+  _txStatus[_txSeq[_txHead] % EDIPTFT_TX_HISTORY] = status;
+  _txHead = (_txHead + 1) % EDIPTFT_TX_SLOTS;
+  _txCount--;
+  _txWaiting = false;
+  _txBackoff = false;
+}
+
+
+void EDIPTFT::expectAck() {
+  _rxAck = 0;
+  _rxExpectAck = true;
+}
+
+
+char EDIPTFT::waitAck() {
+  unsigned long start = millis();
+  char ack;
+
+  while (_rxAck == 0) {
+    receive();
+    if (_rxAck == 0 && millis() - start >= _ackTimeout) {
+      // a late ACK must not be taken for the ACK of the next packet
+      _rxExpectAck = false;
+      STAT(_stats.timeouts++);
+      return EDIP_ERR_TIMEOUT;
     }
   }
+  ack = _rxAck;
+  _rxAck = 0;
+  if (ack != ACK) {
+    STAT(_stats.naks++);
+    return EDIP_ERR_NAK;
+  }
+  STAT(countLatency(EDIP_FAMILY_REQUEST));
+  return EDIP_OK;
 }
 
 
-void EDIPTFT::sendSmallDC2(char* data, char len) {
-  unsigned char i, bcc;
-  char ok = 0;
+void EDIPTFT::receive() {
+  int c;
 
-  while (ok == 0) {
+  if (_rxState != RX_IDLE && millis() - _rxLast >= _ackTimeout) {
+    // incomplete response, resynchronize on the next byte
+    _rxState = RX_IDLE;
+  }
+  while (_transport->available() > 0) {
+    c = _transport->read();
+    if (c < 0) {
+      break;
+    }
+    _rxLast = millis();
+    STAT(_stats.bytesReceived++);
+    receiveByte(c);
+  }
+}
 
-    sendByte(0x12);
-    bcc = 0x12;
 
-    for(i=0; i < len; i++) {
-      sendByte(data[i]);
-      bcc = bcc + data[i];
+void EDIPTFT::receiveByte(unsigned char c) {
+  switch (_rxState) {
+    case RX_IDLE:
+      if (c == ACK || c == NAK) {
+        // ACK/NAK nobody waits for (e.g. after a timeout) is dropped
+        if (_rxExpectAck) {
+          _rxAck = c;
+          _rxExpectAck = false;
+        }
+      }
+      else if (c == DC1 || c == DC2) {
+        _rxType = c;
+        _rxBcc = c;
+        _rxState = RX_LEN;
+      }
+      return;
+
+    case RX_LEN:
+      _rxLen = c;
+      _rxBcc += c;
+      _rxPos = 0;
+      _rxState = _rxLen ? RX_DATA : RX_BCC;
+      return;
+
+    case RX_DATA:
+      if (_rxPos < EDIPTFT_RX_SIZE) {
+        _rxData[_rxPos] = c;
+      }
+      _rxBcc += c;
+      if (++_rxPos == _rxLen) {
+        _rxState = RX_BCC;
+      }
+      return;
+
+    case RX_BCC:
+      _rxState = RX_IDLE;
+      // responses nobody waits for are dropped
+      if (_rxExpect == _rxType) {
+        _rxExpect = 0;
+        _rxResult = c == _rxBcc ? _rxLen : EDIP_ERR_CHECKSUM;
+      }
+      return;
+  }
+}
+
+
+int EDIPTFT::waitResponse() {
+  unsigned long start = millis();
+  unsigned long last = _rxLast;
+
+  while (_rxExpect != 0) {
+    receive();
+    if (_rxLast != last) {
+      // the timeout applies to each byte, not to the whole frame
+      last = _rxLast;
+      start = millis();
     }
-    sendByte(bcc);
-    waitBytesAvailable();
-    if (bytesAvailable() > 0) {
-      if (readByte() == ACK) ok = 1;
-      else ok = 0;
+    if (_rxExpect != 0 && millis() - start >= _ackTimeout) {
+      _rxExpect = 0;
+      return EDIP_ERR_TIMEOUT;
     }
-    else {
-      delay(2000);
-      ok = 0;
+  }
+  return _rxResult;
+}
+
+
+int EDIPTFT::request(char* command, char len, char response) {
+  char repeat [] = {
+    0x01, 'R'
+  };
+  unsigned char tries;
+  int result = sendSmallDC2(command, len, response);
+
+  for (tries = 0; result == EDIP_OK; tries++) {
+    result = waitResponse();
+    if (result != EDIP_ERR_CHECKSUM || tries >= _maxRetries) {
+      break;
+    }
+    // ask the display to send the last response again
+    result = sendSmallDC2(repeat, sizeof(repeat), response);
+  }
+  if (result < 0) {
+    _lastError = result;
+  }
+  return result;
+}
+
+
+void EDIPTFT::waitTxIdle() {
+  while (_txCount > 0) {
+    serviceTx();
+  }
+}
+
+
+void EDIPTFT::sendFrame(const char* frame, unsigned char len) {
+  // one write, so DMA and buffered transports send the frame in one go
+  _transport->write(frame, len);
+  STAT(_stats.bytesSent += len);
+}
+
+
+char EDIPTFT::sendSmallDC2(char* data, char len, char response) {
+  unsigned char i, bcc, tries;
+  char frame[DC2_FRAME_SIZE];
+  char result;
+
+  // don't queue a request whose response can never arrive
+  if (!_transport->requests()) {
+    _lastError = EDIP_ERR_UNSUPPORTED;
+    return EDIP_ERR_UNSUPPORTED;
+  }
+
+  // keep the order of queued commands and protocol commands
+  flush();
+  waitTxIdle();
+
+  // data starts with its length, so the frame is DC2, data, checksum
+  frame[0] = DC2;
+  bcc = DC2;
+  for (i = 0; i < (unsigned char)len; i++) {
+    frame[1 + i] = data[i];
+    bcc = bcc + data[i];
+  }
+  frame[1 + i] = bcc;
+
+  for (tries = 0; ; tries++) {
+    // set up before sending, the response may follow the ACK immediately
+    _rxExpect = response;
+    expectAck();
+    STAT(_stats.requests++);
+    STAT(_stats.retries += tries > 0);
+    STAT(_statSentAt = micros());
+    sendFrame(frame, len + 2);
+    result = waitAck();
+    if (result == EDIP_OK) {
+      return EDIP_OK;
+    }
+    if (tries >= _maxRetries) {
+      _rxExpect = 0;
+      _lastError = result;
+      invalidateState();
+      return result;
     }
+    delay(retryBackoff(tries));
   }
 }
 
 
-void EDIPTFT::smallProtoSelect(char address) {
+char EDIPTFT::smallProtoSelect(char address) {
   char command [] = {
     0x03, 'A', 'S', address
   };
-  sendSmallDC2(command, sizeof(command));
+  return sendSmallDC2(command, sizeof(command));
 }
 
 
-void EDIPTFT::smallProtoDeselect(char address) {
+char EDIPTFT::smallProtoDeselect(char address) {
   char command [] = {
     0x03, 'A', 'D', address
   };
-  sendSmallDC2(command, sizeof(command));
+  return sendSmallDC2(command, sizeof(command));
 }
 
 
-unsigned char EDIPTFT::datainBuffer() {
-  unsigned char result;
+int EDIPTFT::datainBuffer() {
+  int result;
   char command [] = {
     0x01, 'I'
   };
-  sendSmallDC2(command, sizeof(command));
-  waitandreadByte();
-  waitandreadByte();
-  result=waitandreadByte();
-  waitandreadByte();
-  waitandreadByte();
-  return result;
+  result = request(command, sizeof(command), DC2);
+  if (result < 0) {
+    return result;
+  }
+  // bytes in send buffer, free bytes in receive buffer
+  return result >= 1 ? (unsigned char)_rxData[0] : 0;
 }
 
 
-int EDIPTFT::readBuffer(char* data) {
-    unsigned char len, i;
+int EDIPTFT::readBuffer(char* data, int size) {
+    int len;
     char command [] = {
         0x01, 'S'
     };
-    sendSmallDC2(command, sizeof(command));
-    waitandreadByte();
-    len=waitandreadByte();
-    char result[len];
-    for (i = 0; i < len; i++) {
-        result[i] = waitandreadByte();
-    }
-    memcpy(data, result, len);
-    waitandreadByte();
+    len = request(command, sizeof(command), DC1);
+    if (len < 0) {
+        return len;
+    }
+    if (len > EDIPTFT_RX_SIZE) {
+        len = EDIPTFT_RX_SIZE;
+    }
+    if (len > size) {
+        len = size;
+    }
+    memcpy(data, _rxData, len);
     return len;
 }
 
 
-void EDIPTFT::clear() {
-  this->deleteDisplay();
-  this->removeTouchArea(0, 1);
+char EDIPTFT::clear() {
+  char result = this->deleteDisplay();
+  if (result == EDIP_OK) {
+    result = this->removeTouchArea(0, 1);
+  }
+  return result;
 }
 
 
-void EDIPTFT::deleteDisplay() {
+char EDIPTFT::deleteDisplay() {
     char command [] = {
       27, 'D', 'L'
     };
-    sendData(command, sizeof(command));
+    _barKnown = 0;
+    _instKnown = 0;
+    // nothing held back would stay visible
+    _geoCount = 0;
+    return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::invert() {
+char EDIPTFT::invert() {
   char command [] = {
     27, 'D', 'I'
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setDisplayColor(char fg, char bg) {
+char EDIPTFT::setDisplayColor(char fg, char bg) {
   char command [] = {
     27, 'F', 'D', fg, bg
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_DISPLAYCOLOR, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::fillDisplayColor(char bg) {
+char EDIPTFT::fillDisplayColor(char bg) {
   char command [] = {
     27, 'D', 'F', bg
   };
-  sendData(command, sizeof(command));
+  _geoCount = 0;
+  return sendData(command, sizeof(command));
 }
 
-void EDIPTFT::displayIllumination(unsigned char on) {
+char EDIPTFT::displayIllumination(unsigned char on) {
   char command [] = {
     27, 'Y', 'L', on
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
-void EDIPTFT::setDisplayIlluminationLevel(unsigned char level) {
+char EDIPTFT::setDisplayIlluminationLevel(unsigned char level) {
   char command [] = {
     27, 'Y', 'H', level
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTouchBuzzer(boolean on) {
+char EDIPTFT::setTouchBuzzer(boolean on) {
   char command [] = {
     27, 'A', 'S', on
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
-void EDIPTFT::soundBuzzer(unsigned char duration) {
+char EDIPTFT::soundBuzzer(unsigned char duration) {
   char command [] = {
     27, 'Y', 'S', duration
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
-void EDIPTFT::setOutputPort(unsigned char port, unsigned char value) {
+char EDIPTFT::setOutputPort(unsigned char port, unsigned char value) {
   char command [] = {
     27, 'Y', 'W', port, value
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
-void EDIPTFT::terminalOn(boolean on) {
+char EDIPTFT::terminalOn(boolean on) {
   if (on) {
     char command [] = {27, 'T', 'E'};
-    sendData(command, sizeof(command));
+    return sendData(command, sizeof(command));
   }
   else {
     char command [] = {27, 'T', 'A'};
-    sendData(command, sizeof(command));
+    return sendData(command, sizeof(command));
   }
 }
 
 
-void EDIPTFT::loadImage(int x1, int y1, int nr) {
-    char command [] = {27, 'U', 'I',
-    #if COORD_SIZE == 1
-        (char)x1, (char)y1,
-    #else
-        lowByte(x1), highbyte(x1), lowByte(y1), highByte(y1),
-    #endif
-        nr};
-    sendData(command, sizeof(command));
+char EDIPTFT::loadImage(int x1, int y1, int nr) {
+    char command [4 + 2 * EDIPTFT_MAX_COORD_SIZE] = {
+      27, 'U', 'I'
+    };
+    char* end = putPoint(command + 3, x1, y1);
+    *end++ = nr;
+    return sendData(command, end - command);
 }
 
 
-void EDIPTFT::cursorOn(boolean on) {
+static unsigned long bmpSize(const char* header) {
+  const unsigned char* p = (const unsigned char*)header + 2;
+  return p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) |
+         ((unsigned long)p[3] << 24);
+}
+
+
+char EDIPTFT::beginImage(int x1, int y1, const char* header) {
+  char command [3 + 2 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'U', 'L'
+  };
+  char* end;
+
+  if (header[0] != 'B' || header[1] != 'M') {
+    return EDIP_ERR_IMAGE;
+  }
+  end = putPoint(command + 3, x1, y1);
+  beginCommand();
+  putData(command, end - command);
+  return EDIP_OK;
+}
+
+
+char EDIPTFT::endImage(boolean async) {
+  char result = endCommand();
+  setAsync(async);
+  return _txFailed != _cmdFailed ? _lastError : result;
+}
+
+
+char EDIPTFT::sendImage(int x1, int y1, Stream& bmp) {
+  char header[BMP_HEADER_SIZE];
+  unsigned long size, pos;
+  unsigned long start;
+  boolean async = _async;
+  char result = EDIP_OK;
+  int c;
+
+  for (pos = 0; pos < BMP_HEADER_SIZE; pos++) {
+    start = millis();
+    while ((c = bmp.read()) < 0) {
+      if (millis() - start >= _ackTimeout) {
+        return EDIP_ERR_TIMEOUT;
+      }
+    }
+    header[pos] = c;
+  }
+  if (beginImage(x1, y1, header) != EDIP_OK) {
+    return EDIP_ERR_IMAGE;
+  }
+  size = bmpSize(header);
+  // the display acknowledges one packet while the next one is filled
+  _async = true;
+  putData(header, BMP_HEADER_SIZE);
+  for (; pos < size; pos++) {
+    start = millis();
+    while (result == EDIP_OK && (c = bmp.read()) < 0) {
+      serviceTx();
+      if (millis() - start >= _ackTimeout) {
+        // the display expects the announced size, fill up
+        result = EDIP_ERR_TIMEOUT;
+      }
+    }
+    put(result == EDIP_OK ? c : 0);
+  }
+  if (result != EDIP_OK) {
+    _lastError = result;
+    endImage(async);
+    return result;
+  }
+  return endImage(async);
+}
+
+
+char EDIPTFT::sendImage(int x1, int y1, const char* bmp) {
+  unsigned long size;
+  boolean async = _async;
+
+  if (beginImage(x1, y1, bmp) != EDIP_OK) {
+    return EDIP_ERR_IMAGE;
+  }
+  size = bmpSize(bmp);
+  _async = true;
+  putData(bmp, size);
+  return endImage(async);
+}
+
+
+#ifdef PROGMEM
+char EDIPTFT::sendImage_P(int x1, int y1, const char* bmp) {
+  char header[BMP_HEADER_SIZE];
+  unsigned long size, pos;
+  boolean async = _async;
+
+  for (pos = 0; pos < BMP_HEADER_SIZE; pos++) {
+    header[pos] = pgm_read_byte(bmp + pos);
+  }
+  if (beginImage(x1, y1, header) != EDIP_OK) {
+    return EDIP_ERR_IMAGE;
+  }
+  size = bmpSize(header);
+  _async = true;
+  for (pos = 0; pos < size; pos++) {
+    put(pgm_read_byte(bmp + pos));
+  }
+  return endImage(async);
+}
+#endif
+
+
+char EDIPTFT::requestHardcopy(int x1, int y1, int x2, int y2) {
+  char command [3 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'U', 'H'
+  };
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  return sendData(command, end - command);
+}
+
+
+char EDIPTFT::cursorOn(boolean on) {
   if (on) {
     char command [] = {27, 'T', 'C', 1};
-    sendData(command, sizeof(command));
+    return sendData(command, sizeof(command));
   }
   else {
     char command [] = {27, 'T', 'C', 0};
-    sendData(command, sizeof(command));
+    return sendData(command, sizeof(command));
   }
 }
 
 
-void EDIPTFT::setCursor(char col, char row) {
+char EDIPTFT::setCursor(char col, char row) {
   char command [] = {27, 'T', 'P', col, row};
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::defineBargraph(char dir, char no, int x1, int y1, int x2, int y2, byte sv, byte ev, char type, char mst) {
-  char command [] = {
-    27, 'B', dir, no,
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2,
-    #else
-        lowByte(x1), highByte(x1), lowByte(y1), highByte(y1),
-        lowByte(x2), highByte(x2), lowByte(y2), highByte(y2),
-    #endif
-    char(sv),
-    char(ev),
-    type,
-    mst
+char EDIPTFT::defineBargraph(char dir, char no, int x1, int y1, int x2, int y2, byte sv, byte ev, char type, char mst) {
+  char command [8 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'B', dir, no
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 4, x1, y1, x2, y2);
+  forgetValue(_barKnown, no - 1);
+  *end++ = char(sv);
+  *end++ = char(ev);
+  *end++ = type;
+  *end++ = mst;
+  return sendData(command, end - command);
 }
 
 
-void EDIPTFT::updateBargraph(char no, char val) {
+char EDIPTFT::updateBargraph(char no, char val) {
+  unsigned char i = no - 1;
+  if (_valueInterval && !_recBuffer && i < EDIPTFT_BARGRAPHS) {
+    coalesce(_barPending, _barShown, _barDirty, _barKnown, i, val);
+    return flushValuesIfDue();
+  }
   char command [] = {
     27, 'B', 'A', no, val
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setBargraphColor(char no, char fg, char bg, char fr) {
+char EDIPTFT::setBargraphColor(char no, char fg, char bg, char fr) {
   char command [] = {
     27, 'F', 'B', no, fg, bg, fr
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::linkBargraphLight(char no) {
+char EDIPTFT::linkBargraphLight(char no) {
   char command [] = {
     27, 'Y', 'B', no
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::makeBargraphTouch(char no) {
+char EDIPTFT::makeBargraphTouch(char no) {
   char command [] = {
     27, 'A', 'B', no
   };
-  sendData(command, sizeof(command));
+  // the value can now be changed by touch
+  forgetValue(_barKnown, no - 1);
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::deleteBargraph(char no,char n1) {
+char EDIPTFT::deleteBargraph(char no,char n1) {
   char command [] = {
     27, 'B', 'D', no, n1
   };
-  sendData(command, sizeof(command));
+  forgetValue(_barKnown, no - 1);
+  forgetValue(_barDirty, no - 1);
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::defineInstrument(char no, int x1, int y1, char image, char angle, char sv, char ev) {
-  char command [] = {
-    27, 'I', 'P', no,
-    #if COORD_SIZE == 1
-        x1, y1,
-    #else
-        lowByte(x1), highByte(x1), lowByte(y1), highByte(y1),
-    #endif
-    image, angle, sv, ev
+char EDIPTFT::defineInstrument(char no, int x1, int y1, char image, char angle, char sv, char ev) {
+  char command [8 + 2 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'I', 'P', no
   };
-  sendData(command, sizeof(command));
+  char* end = putPoint(command + 4, x1, y1);
+  forgetValue(_instKnown, no - 1);
+  *end++ = image;
+  *end++ = angle;
+  *end++ = sv;
+  *end++ = ev;
+  return sendData(command, end - command);
 }
 
 
-void EDIPTFT::updateInstrument(char no, char val) {
+char EDIPTFT::updateInstrument(char no, char val) {
+  unsigned char i = no - 1;
+  if (_valueInterval && !_recBuffer && i < EDIPTFT_INSTRUMENTS) {
+    coalesce(_instPending, _instShown, _instDirty, _instKnown, i, val);
+    return flushValuesIfDue();
+  }
   char command [] = {
     27, 'I', 'A', no, val
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::redrawInstrument(char no) {
+char EDIPTFT::redrawInstrument(char no) {
   char command [] = {
     27, 'I', 'N', no
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::deleteInstrument(char no, char n1, char n2) {
+char EDIPTFT::deleteInstrument(char no, char n1, char n2) {
   char command [] = {
-    27, 'B', 'D', no, n1, n2
+    27, 'I', 'D', no, n1, n2
   };
-  sendData(command, sizeof(command));
+  forgetValue(_instKnown, no - 1);
+  forgetValue(_instDirty, no - 1);
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setLineColor(char fg, char bg) {
+char EDIPTFT::setLineColor(char fg, char bg) {
   char command [] = {
     27, 'F', 'G', fg, bg
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_LINECOLOR, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setLineThick(char x, char y) {
+char EDIPTFT::setLineThick(char x, char y) {
   char command [] = {
     27, 'G', 'Z', x, y
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_LINETHICK, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTextColor(char fg, char bg) {
+char EDIPTFT::setTextColor(char fg, char bg) {
   char command [] = {
     27, 'F', 'Z', fg, bg
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TEXTCOLOR, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTextFont(char font) {
+char EDIPTFT::setTextFont(char font) {
   char command [] = {
     27, 'Z', 'F', font
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TEXTFONT, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTextAngle(char angle) {
+char EDIPTFT::setTextAngle(char angle) {
   // 0 = 0°, 1 = 90°, 2 = 180°, 3 = 270°
   char command [] = {
     27, 'Z', 'W', angle
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TEXTANGLE, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::drawText(int x1, int y1, char justification, const char* text) {
-  byte len = strlen(text);
-  byte i;
-  char helper [len + 4 + 2 * COORD_SIZE];
-  char command [] = {
-    27, 'Z', justification,
-    #if COORD_SIZE == 1
-        x1, y1,
-    #else
-        lowByte(x1), highByte(x1), lowByte(y1), highByte(y1),
-    #endif
+char EDIPTFT::drawText(int x1, int y1, char justification, const char* text) {
+  char command [3 + 2 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'Z', justification
   };
-  for (i = 0; i <= 4; i++) helper[i] = command[i];
-  for (i = 0; i <= len; i++) {
-      helper[i + 5] = text[i];
-  }
-  sendData(helper, sizeof(helper));
+  char* end = putPoint(command + 3, x1, y1);
+  beginCommand();
+  putData(command, end - command);
+  putText(text);
+  return endCommand();
 }
 
 
-void EDIPTFT::drawLine(int x1, int y1, int x2, int y2) {
-  char command [] = {
-    27,'G','D',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2)
-    #endif
+char EDIPTFT::drawLine(int x1, int y1, int x2, int y2) {
+  if (queueShape(SHAPE_LINE, x1, y1, x2, y2)) {
+    return EDIP_OK;
+  }
+  char command [3 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'G', 'D'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  return sendData(command, end - command);
 }
 
 
-void EDIPTFT::drawRect(int x1, int y1, int x2, int y2) {
-  char command [] = {
-    27,'G','R',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2)
-    #endif
+char EDIPTFT::drawRect(int x1, int y1, int x2, int y2) {
+  char command [3 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'G', 'R'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  return sendData(command, end - command);
 }
 
 
-void EDIPTFT::drawRectf(int x1, int y1, int x2, int y2, char color) {
-  char command [] = {
-    27,'R','F',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2,
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2),
-    #endif
-    color
+char EDIPTFT::drawRectf(int x1, int y1, int x2, int y2, char color) {
+  if (queueShape(SHAPE_FILLC, x1, y1, x2, y2, color)) {
+    return EDIP_OK;
+  }
+  char command [4 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'R', 'F'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  *end++ = color;
+  return sendData(command, end - command);
 }
 
 
-void EDIPTFT::clearRect(int x1, int y1, int x2, int y2) {
-  char command [] = {
-    27,'R','L',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2)
-    #endif
+char EDIPTFT::clearRect(int x1, int y1, int x2, int y2) {
+  if (queueShape(SHAPE_CLEAR, x1, y1, x2, y2)) {
+    return EDIP_OK;
+  }
+  char command [3 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'R', 'L'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  return sendData(command, end - command);
 }
 
-void EDIPTFT::invertRect(int x1, int y1, int x2, int y2) {
-  char command [] = {
-    27,'R','I',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2)
-    #endif
+char EDIPTFT::invertRect(int x1, int y1, int x2, int y2) {
+  char command [3 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'R', 'I'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  return sendData(command, end - command);
 }
 
-void EDIPTFT::fillRect(int x1, int y1, int x2, int y2) {
-  char command [] = {
-    27,'R','S',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2)
-    #endif
+char EDIPTFT::fillRect(int x1, int y1, int x2, int y2) {
+  if (queueShape(SHAPE_FILL, x1, y1, x2, y2)) {
+    return EDIP_OK;
+  }
+  char command [3 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'R', 'S'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  return sendData(command, end - command);
 }
 
-void EDIPTFT::fillRectp(int x1, int y1, int x2, int y2, char pattern) {
-  char command [] = {
-    27,'R','M',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2, pattern
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2),
-        pattern
-    #endif
+char EDIPTFT::fillRectp(int x1, int y1, int x2, int y2, char pattern) {
+  char command [4 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'R', 'M'
   };
-  sendData(command, sizeof(command));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  *end++ = pattern;
+  return sendData(command, end - command);
 }
 
 
 
 
-void EDIPTFT::defineTouchKey(int x1, int y1, int x2, int y2, char down, char up,
+char EDIPTFT::defineTouchKey(int x1, int y1, int x2, int y2, char down, char up,
                              const char* text) {
-  byte len = strlen(text);
-  byte i;
-  char helper [len + 6 + 4 * COORD_SIZE];
-  char command [] = {
-    27, 'A', 'T',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2,
-    #else
-        lowByte(x1), highByte(x1), lowByte(y1), highByte(y1),
-        lowByte(x2), highByte(x2), lowByte(y2), highByte(y2),
-    #endif
-    down, up
+  char command [5 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'A', 'T'
   };
-  for (i = 0; i < (5 + 4 * COORD_SIZE); i++) helper[i] = command[i];
-  for (i = 0; i <= len+1; i++) helper[i + 5 + 4 * COORD_SIZE] = text[i];
-  sendData(helper, sizeof(helper));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  *end++ = down;
+  *end++ = up;
+  beginCommand();
+  putData(command, end - command);
+  putText(text);
+  return endCommand();
 }
 
 
-void EDIPTFT::defineTouchSwitch(int x1, int y1, int x2, int y2,
+char EDIPTFT::defineTouchSwitch(int x1, int y1, int x2, int y2,
                                 char down, char up, const char* text) {
-  byte len = strlen(text);
-  byte i;
-  char helper [len + 6 + 4 * COORD_SIZE];
-  char command [] = {
-    27, 'A', 'K',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2,
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2),
-    #endif
-    down, up
+  char command [5 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'A', 'K'
   };
-  for (i = 0; i < 5 + 4 * COORD_SIZE; i++) helper[i] = command[i];
-  for (i = 0; i <= len; i++) helper[i + 5 + 4 * COORD_SIZE] = text[i];
-  sendData(helper, sizeof(helper));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  *end++ = down;
+  *end++ = up;
+  beginCommand();
+  putData(command, end - command);
+  putText(text);
+  return endCommand();
 }
 
 
-void EDIPTFT::defineTouchSwitch(int x, int y, int img, char downcode,
+char EDIPTFT::defineTouchSwitch(int x, int y, int img, char downcode,
                                 char upcode, const char* text) {
-  byte len = strlen(text);
-  byte i;
-  byte n = 6 + 2 * COORD_SIZE;
-  char helper [len + n + 1];
-  char command [] = {
-    27, 'A', 'J',
-    #if COORD_SIZE == 1
-        x, y,
-    #else
-        lowByte(x), highByte(x), lowByte(y), highByte(y),
-    #endif
-    img, downcode, upcode
+  char command [6 + 2 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'A', 'J'
   };
-  for (i = 0; i < n; i++) helper[i] = command[i];
-  for (i = 0; i <= len; i++) helper[i + n] = text[i];
-  sendData(helper, sizeof(helper));
+  char* end = putPoint(command + 3, x, y);
+  *end++ = img;
+  *end++ = downcode;
+  *end++ = upcode;
+  beginCommand();
+  putData(command, end - command);
+  putText(text);
+  return endCommand();
 }
 
 
-void EDIPTFT::setTouchSwitch(char code,char value) {
+char EDIPTFT::setTouchSwitch(char code,char value) {
   char command [] = {
     27, 'A', 'P', code, value
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTouchkeyColors(
+char EDIPTFT::setTouchkeyColors(
   char n1, char n2, char n3, char s1, char s2, char s3) {
   char command [] = {
     27, 'F', 'E', n1, n2, n3, s1, s2, s3
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TOUCHCOLORS, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTouchkeyFont(char font) {
+char EDIPTFT::setTouchkeyFont(char font) {
   char command [] = {
     27, 'A', 'F', font
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TOUCHFONT, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTouchkeyLabelColors(char nf, char sf) {
+char EDIPTFT::setTouchkeyLabelColors(char nf, char sf) {
   char command [] = {
     27, 'F', 'A', nf, sf
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TOUCHLABEL, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTouchGroup(char group) {
+char EDIPTFT::setTouchGroup(char group) {
   char command [] = {
     27, 'A', 'R', group
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_TOUCHGROUP, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::removeTouchArea(char code, char n1) {
+char EDIPTFT::removeTouchArea(char code, char n1) {
   char command [] = {
     27, 'A', 'L', code, n1
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::callMacro(uint nr) {
+char EDIPTFT::callMacro(uint nr) {
   char command[] = {
     27, 'M', 'N', nr
   };
-  sendData(command, sizeof(command));
+  // the macro may change any state behind our back
+  invalidateState();
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::callTouchMacro(uint nr) {
+char EDIPTFT::callTouchMacro(uint nr) {
   char command[] = {
     27, 'M', 'T', nr
   };
-  sendData(command, sizeof(command));
+  // the macro may change any state behind our back
+  invalidateState();
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::callMenuMacro(uint nr) {
+char EDIPTFT::callMenuMacro(uint nr) {
   char command[] = {
     27, 'M', 'M', nr
   };
-  sendData(command, sizeof(command));
+  // the macro may change any state behind our back
+  invalidateState();
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::defineTouchMenu(int x1, int y1, int x2, int y2,
+char EDIPTFT::defineTouchMenu(int x1, int y1, int x2, int y2,
     char downcode, char upcode, char mnucode, const char *text) {
-  byte len = strlen(text);
-  byte n = 6 + 4 * COORD_SIZE;
-  char helper [len + n + 1];
-
-  char command [] = {
-    27, 'A', 'M',
-    #if COORD_SIZE == 1
-        x1, y1, x2, y2,
-    #else
-        lowByte(x1),highByte(x1),lowByte(y1),highByte(y1),
-        lowByte(x2),highByte(x2),lowByte(y2),highByte(y2),
-    #endif
-    downcode, upcode, mnucode
+  char command [6 + 4 * EDIPTFT_MAX_COORD_SIZE] = {
+    27, 'A', 'M'
   };
-  for (int i = 0; i < n; i++) helper[i] = command[i];
-  for (int i = 0; i <= len; i++) helper[i + n] = text[i];
-  sendData(helper, sizeof(helper));
+  char* end = putRect(command + 3, x1, y1, x2, y2);
+  *end++ = downcode;
+  *end++ = upcode;
+  *end++ = mnucode;
+  beginCommand();
+  putData(command, end - command);
+  putText(text);
+  return endCommand();
 }
 
 
-void EDIPTFT::openTouchMenu() {
+char EDIPTFT::openTouchMenu() {
   char command [] = {
     27, 'N', 'T', 2
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setMenuFont(char font) {
+char EDIPTFT::setMenuFont(char font) {
   char command [] = {
     27, 'N', 'F', font
   };
-  sendData(command, sizeof(command));
+  if (cached(SHADOW_MENUFONT, command + 3, sizeof(command) - 3)) {
+    return EDIP_OK;
+  }
+  return sendData(command, sizeof(command));
 }
 
 
-void EDIPTFT::setTouchMenuAutomation(bool val) {
+char EDIPTFT::setTouchMenuAutomation(bool val) {
   char n1 = val ? 1 : 0;
   char command [] = {
     27, 'N', 'T', n1
   };
-  sendData(command, sizeof(command));
+  return sendData(command, sizeof(command));
 }
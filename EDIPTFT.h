@@ -35,6 +35,7 @@
   #endif
   // includes only needed for Arduino platform go here
 #endif
+#include "EDIPTransport.h"
 
 //Devices
 #define EDIP128 1
@@ -42,10 +43,120 @@
 #define EDIP240 1
 #define EDIP320 2
 
-//Set your device
+//Set your device (default for EDIPTFT objects without device traits)
 #define DEVICE EDIP240
 #define COORD_SIZE DEVICE  //Byte count for coordinates
+#define EDIPTFT_MAX_COORD_SIZE 2
+
+// Serial port used by EDIPTFT objects that are created without a transport.
+// Define EDIPTFT_NO_SERIAL_DEV on boards without this port.
+#ifndef SERIAL_DEV
 #define SERIAL_DEV Serial2
+#endif
+
+// Size of the small protocol packet buffer used for batching (max. 255)
+#ifndef EDIPTFT_PACKET_SIZE
+#define EDIPTFT_PACKET_SIZE 64
+#endif
+
+// Size of the buffer for responses from the display (max. 255)
+#ifndef EDIPTFT_RX_SIZE
+#define EDIPTFT_RX_SIZE EDIPTFT_PACKET_SIZE
+#endif
+
+// Number of packets that can be queued for transmission
+#ifndef EDIPTFT_TX_SLOTS
+#define EDIPTFT_TX_SLOTS 4
+#endif
+
+// Number of packets whose completion status is remembered
+#define EDIPTFT_TX_HISTORY 16
+
+// Packet status
+#define EDIP_UNKNOWN 0
+#define EDIP_QUEUED 1
+#define EDIP_SENT 2
+#define EDIP_DONE 3
+#define EDIP_FAILED 4
+
+// Error codes; all commands return EDIP_OK or one of the (negative) codes.
+// With batching or in async mode a command only fails if an earlier packet
+// failed while it was queued, see packetStatus() and lastError().
+#define EDIP_OK 0
+#define EDIP_ERR_TIMEOUT -1
+#define EDIP_ERR_NAK -2
+#define EDIP_ERR_CHECKSUM -3
+#define EDIP_ERR_BAUD -4
+#define EDIP_ERR_OVERFLOW -5
+#define EDIP_ERR_IMAGE -6
+#define EDIP_ERR_UNSUPPORTED -7
+
+// Size of the shadow copy of the display state (see setStateCache())
+#define EDIPTFT_SHADOW_SIZE 21
+
+// Number of bargraphs and instruments whose updates can be coalesced
+// (max. 32 each)
+#ifndef EDIPTFT_BARGRAPHS
+#define EDIPTFT_BARGRAPHS 32
+#endif
+#ifndef EDIPTFT_INSTRUMENTS
+#define EDIPTFT_INSTRUMENTS 8
+#endif
+
+// Transmit statistics (see EDIPTFT::stats()), enable here or with
+// -DEDIPTFT_STATS for the library and the sketch alike
+// #define EDIPTFT_STATS
+
+// Command families of the ACK latency histogram
+#define EDIP_FAMILY_TEXT 0        // text and terminal (ESC Z, ESC T)
+#define EDIP_FAMILY_GEOMETRY 1    // display, lines, rectangles, images
+#define EDIP_FAMILY_BARGRAPH 2    // bargraphs and instruments
+#define EDIP_FAMILY_TOUCH 3       // touch keys, switches, areas
+#define EDIP_FAMILY_OTHER 4       // colors, fonts, macros, ...
+#define EDIP_FAMILY_REQUEST 5     // DC2 protocol requests
+#define EDIP_FAMILIES 6
+
+// Latency bins: < 1, < 2, < 4, ... < 64 ms, >= 64 ms
+#define EDIP_LATENCY_BINS 8
+
+/*! \brief Transmit statistics
+ */
+struct EDIPStats {
+  unsigned long bytesSent;
+  unsigned long bytesReceived;
+  unsigned long packets;       // DC1 packets sent, including repeats
+  unsigned long requests;      // DC2 requests sent, including repeats
+  unsigned long naks;
+  unsigned long retries;       // packets and requests sent again
+  unsigned long timeouts;      // ACKs that did not arrive in time
+  unsigned long latency[EDIP_FAMILIES][EDIP_LATENCY_BINS];
+};
+
+// Number of rectangles and lines the geometry coalescer holds back
+#ifndef EDIPTFT_GEOMETRY_QUEUE
+#define EDIPTFT_GEOMETRY_QUEUE 8
+#endif
+
+// Default ACK timeout (ms), number of retries and base retry delay (ms)
+#ifndef EDIPTFT_ACK_TIMEOUT
+#define EDIPTFT_ACK_TIMEOUT 100
+#endif
+#ifndef EDIPTFT_RETRIES
+#define EDIPTFT_RETRIES 3
+#endif
+#ifndef EDIPTFT_RETRY_DELAY
+#define EDIPTFT_RETRY_DELAY 10
+#endif
+#define EDIPTFT_MAX_BACKOFF 1000
+
+// Highest baud rate tried by negotiate() and number of requests that
+// must pass without retry before a new baud rate is accepted
+#ifndef EDIPTFT_MAX_BAUD
+#define EDIPTFT_MAX_BAUD 115200
+#endif
+#ifndef EDIPTFT_BAUD_CHECKS
+#define EDIPTFT_BAUD_CHECKS 4
+#endif
 
 #define EA_BLACK 1
 #define EA_BLUE 2
@@ -77,46 +188,335 @@
 #define NAK 0x15
 #define ACK 0x06
 #define ESC 0x1B
+#define DC1 0x11
+#define DC2 0x12
 
 #define uint unsigned int
 
+/*! \brief Device traits
+ *
+ * Coordinate size in bytes and resolution of a display family, used as
+ * template parameter of EDIPDisplay.
+ */
+template <unsigned char CoordSize, int Width, int Height>
+struct EDIPDeviceTraits {
+  static const unsigned char coordSize = CoordSize;
+  static const int width = Width;
+  static const int height = Height;
+};
+
+typedef EDIPDeviceTraits<1, 128, 64> EDIP128Device;
+typedef EDIPDeviceTraits<1, 160, 104> EDIP160Device;
+typedef EDIPDeviceTraits<1, 240, 128> EDIP240Device;
+typedef EDIPDeviceTraits<2, 320, 240> EDIP320Device;
+typedef EDIPDeviceTraits<2, 320, 240> EDIPTFT32Device;
+typedef EDIPDeviceTraits<2, 480, 272> EDIPTFT43Device;
+typedef EDIPDeviceTraits<2, 640, 480> EDIPTFT57Device;
+typedef EDIPDeviceTraits<2, 800, 480> EDIPTFT70Device;
+
+/*! \brief Small protocol settings reported by the display
+ */
+struct EDIPProtocolInfo {
+  unsigned char maxPacketSize;   // longest packet the display accepts
+  unsigned char sendPacketSize;  // longest response packet it sends
+  unsigned char timeout;         // packet timeout in 1/100 s
+};
+
 class EDIPTFT {
   public:
+#ifndef EDIPTFT_NO_SERIAL_DEV
+    /*! \brief Display on the default serial port `SERIAL_DEV`
+     */
     EDIPTFT(boolean smallprotocol=true);
+#endif
+
+    /*! \brief Display on \a transport
+     *
+     * Use a separate transport for every display, e.g. one
+     * EDIPSerialTransport per UART. The transport must outlive the EDIPTFT
+     * object. \a coordSize is the number of bytes per coordinate (1 for
+     * displays up to 255 pixels, 2 otherwise), see also EDIPDisplay.
+     */
+    EDIPTFT(EDIPTransport& transport, boolean smallprotocol=true,
+            unsigned char coordSize=COORD_SIZE);
 
     void begin(long baud=115200);
 
+    /*! \brief Negotiate packet size and baud rate
+     *
+     * Reads the protocol info of the display, limits packets to the
+     * size it accepts and makes it send responses that fit into
+     * EDIPTFT_RX_SIZE. Then moves both ends to the highest supported
+     * baud rate up to \a maxBaud at which the display still answers,
+     * trying lower rates if a rate fails (see setBaudRate()). Call after
+     * begin() with the current rate of the display.
+     *
+     * \return `EDIP_OK` or error code if the display does not answer at
+     *         all or does not shorten its responses; the baud rate is
+     *         left alone then
+     */
+    char negotiate(long maxBaud=EDIPTFT_MAX_BAUD);
+
+    /*! \brief Read the small protocol settings of the display
+     */
+    char protocolInfo(EDIPProtocolInfo& info);
+
+    /*! \brief Set the response packet size and packet timeout of the display
+     *
+     * \param sendPacketSize longest packet the display sends (1..255)
+     * \param timeout packet timeout in 1/100 s
+     */
+    char setProtocol(unsigned char sendPacketSize, unsigned char timeout);
+
+    /*! \brief Switch the baud rate of display and transport
+     *
+     * Tells the display to switch to \a baud, follows with the transport
+     * and checks that EDIPTFT_BAUD_CHECKS requests in a row are answered
+     * without retry. If not, the display is told to go back and the
+     * transport returns to the old rate.
+     *
+     * \return `EDIP_OK`, `EDIP_ERR_BAUD` if there is no code for \a baud or
+     *         the error code of the failed check
+     */
+    char setBaudRate(long baud);
+
+    /*! \brief Current baud rate
+     */
+    long baudRate();
+
+    /*! \brief Maximum number of bytes per packet
+     *
+     * EDIPTFT_PACKET_SIZE or less after negotiate()
+     */
+    unsigned char packetSize();
+
+    /*! \brief Number of bytes per coordinate
+     */
+    unsigned char coordSize();
+
     // helper functions
     char readByte();
-    char waitandreadByte();
-    unsigned char datainBuffer();
-    int readBuffer(char* data);
-    void smallProtoSelect(char address);
-    void smallProtoDeselect(char address);
-    void sendData(char* data, char len);
+    int waitandreadByte();
+    int datainBuffer();
+
+    /*! \brief Read the send buffer of the display
+     *
+     * Reads one packet from the send buffer (touch codes, bargraph values,
+     * ...) into \a data. Bytes beyond \a size are discarded.
+     *
+     * \return number of bytes stored in \a data or error code
+     */
+    int readBuffer(char* data, int size=255);
+
+    char smallProtoSelect(char address);
+    char smallProtoDeselect(char address);
+    char sendData(char* data, char len);
+
+    /*! \brief Batch commands into one packet
+     *
+     * If \a on is true, commands are collected in a packet buffer instead of
+     * being sent one packet each. The buffer is sent when it is full, when
+     * flush() is called or when the oldest buffered command is older than
+     * \a timeout milliseconds (checked on every command and in poll()).
+     * Switching batching off flushes the buffer.
+     *
+     * \param on enable/disable batching
+     * \param timeout maximum time in ms a command stays in the buffer
+     *                (0: no deadline, only flush when full or on flush())
+     */
+    void setBatching(boolean on, unsigned int timeout=0);
+
+    /*! \brief Send buffered commands
+     *
+     * Send all commands collected in batching mode as one packet
+     *
+     * \return `EDIP_OK` or error code of the packet (blocking mode only)
+     */
+    char flush();
+
+    /*! \brief Non-blocking transmission
+     *
+     * If \a on is true, packets are queued and sent by poll(): the next
+     * packet goes out as soon as the previous one is acknowledged, and
+     * commands return without waiting for the ACK. Commands only block
+     * when all EDIPTFT_TX_SLOTS packets are in flight. If \a on is false
+     * (default), every packet is sent and acknowledged before the command
+     * returns. Switching it off waits for the queue to drain.
+     */
+    void setAsync(boolean on);
+
+    /*! \brief Service the display connection
+     *
+     * Call regularly from the main loop. Sends the batch buffer if its
+     * deadline has passed and, in async mode, processes ACKs and sends the
+     * next queued packet.
+     */
+    void poll();
+
+    /*! \brief Process received bytes
+     *
+     * Frames the bytes from the display into ACK, NAK and DC1/DC2
+     * responses and hands each one to the packet or request waiting for
+     * it; a response with wrong checksum is requested again. Bytes that
+     * nobody waits for are dropped, so late or unsolicited bytes cannot be
+     * taken for the answer to a later packet. Called by poll() and while
+     * waiting; can also be called from `serialEvent()`.
+     */
+    void receive();
+
+    /*! \brief Packet of the last command
+     *
+     * \return sequence number of the packet holding the last command,
+     *         to be passed to packetStatus()
+     */
+    unsigned int lastPacket();
+
+    /*! \brief Status of a packet
+     *
+     * \param packet sequence number returned by lastPacket()
+     * \return `EDIP_QUEUED`, `EDIP_SENT` (waiting for ACK), `EDIP_DONE`,
+     *         `EDIP_FAILED` (no ACK after all retries) or `EDIP_UNKNOWN` if
+     *         the packet is older than the last EDIPTFT_TX_HISTORY packets
+     */
+    unsigned char packetStatus(unsigned int packet);
+
+    /*! \brief Number of packets queued or waiting for ACK
+     */
+    unsigned char pendingPackets();
+
+    /*! \brief Timeouts and retries
+     *
+     * A packet that is not acknowledged within \a ackTimeout ms or is
+     * answered with NAK is sent again up to \a retries times. The n-th
+     * retry waits `retryDelay * 2^(n-1)` ms (max. EDIPTFT_MAX_BACKOFF)
+     * before resending. After that the packet is dropped with
+     * `EDIP_FAILED` status. \a ackTimeout also limits the wait for every
+     * byte of a response.
+     */
+    void setTimeouts(unsigned int ackTimeout, unsigned char retries,
+                     unsigned int retryDelay);
+
+    /*! \brief Error code of the last failed packet or request
+     */
+    char lastError();
+
+#ifdef EDIPTFT_STATS
+    /*! \brief Transmit statistics since the start or resetStats()
+     *
+     * The ACK latency is measured from the start of a packet to its ACK
+     * and counted for the family of the first command in the packet.
+     */
+    const EDIPStats& stats();
+    void resetStats();
+#endif
+
+    /*! \brief Skip redundant state commands
+     *
+     * If \a on is true, the library remembers the colors, fonts, text
+     * angle, line thickness, touch group etc. it has set and does not
+     * send a state command that would not change the display state.
+     * Call invalidateState() when the display state changed without the
+     * library knowing, e.g. after a reset of the display. Macro calls and
+     * failed packets invalidate the cache automatically.
+     */
+    void setStateCache(boolean on);
+
+    /*! \brief Forget the cached display state
+     *
+     * The next state command of every kind is sent again.
+     */
+    void invalidateState();
+
+    /*! \brief Coalesce bargraph and instrument updates
+     *
+     * With an \a interval other than 0, updateBargraph() and
+     * updateInstrument() only store the new value. The newest value of
+     * every bargraph and instrument is sent at most every \a interval ms
+     * (from the update calls, poll() or flushValues()), all in one
+     * packet. Values that are already on screen are not sent again.
+     * Set \a interval to 0 (default) to send every update immediately.
+     *
+     * \param interval minimum time between two value frames in ms
+     */
+    void setUpdateRate(unsigned int interval);
+
+    /*! \brief Send pending bargraph and instrument values now
+     */
+    char flushValues();
+
+    /*! \brief Coalesce rectangles and lines
+     *
+     * If \a on is true, fillRect(), clearRect(), drawRectf() and
+     * drawLine() are held back in a queue of EDIPTFT_GEOMETRY_QUEUE
+     * shapes. Adjacent rectangles of the same kind and color are merged,
+     * horizontal, vertical and diagonal line segments that continue each
+     * other are joined, and shapes that a later rectangle paints over
+     * completely are dropped; clearing the display drops them all. Any
+     * other command, flush() and poll() send the queue first, so the
+     * order of everything else is kept. Held back shapes return
+     * `EDIP_OK`, their errors are reported by the command that sends them.
+     */
+    void setGeometryCoalescing(boolean on);
+
+    /*! \brief Record commands instead of sending them
+     *
+     * Until endRecording(), the ESC commands of all drawing calls are
+     * written to \a buffer as they would be stored in a display macro,
+     * without small protocol framing. Nothing is sent to the display;
+     * the state cache and value coalescing are bypassed, so the recording
+     * does not depend on what was sent before. Protocol requests
+     * (datainBuffer(), select, ...) still go to the display.
+     * See extras/macro for packaging recordings into a macro file.
+     *
+     * \param buffer memory for the recording
+     * \param size size of \a buffer in bytes
+     */
+    void beginRecording(char* buffer, unsigned int size);
+
+    /*! \brief Stop recording
+     *
+     * \return number of recorded bytes or `EDIP_ERR_OVERFLOW` if the
+     *         buffer was too small
+     */
+    int endRecording();
+
+    /*! \brief Number of bytes recorded so far
+     *
+     * Writes shapes held back by geometry coalescing into the recording
+     * first, so the next command starts at the returned position.
+     */
+    unsigned int recordedBytes();
+
+    /*! \brief Send pre-encoded ESC commands
+     *
+     * Sends \a len bytes of commands, e.g. a recording, filling whole
+     * packets. The state cache is invalidated since the commands may
+     * change the display state.
+     */
+    char sendCommands(const char* data, unsigned int len);
 
     // Basic display functions
     /*! \brief Clear display
      *
      * Clear display contents (all pixels off) and remove touch areas
      */
-    void clear();
+    char clear();
 
     /*! \brief Delete display
      *
      * Delete display contents (all pixels off). Touch areas are still active.
      */
-    void deleteDisplay();
+    char deleteDisplay();
 
     /*! \brief Invert display
      *
      * Invert display contents (invert all pixels)
      */
-    void invert();
+    char invert();
 
-    void setDisplayColor(char fg, char bg);
+    char setDisplayColor(char fg, char bg);
 
-    void fillDisplayColor(char bg);
+    char fillDisplayColor(char bg);
 
 
     /*! \brief Display illumination on/duration
@@ -125,7 +525,7 @@ class EDIPTFT {
      *
      * \param on determine display illumination state
      */
-    void displayIllumination(unsigned char on);
+    char displayIllumination(unsigned char on);
 
     /*! \brief Display illumination level
      *
@@ -133,7 +533,7 @@ class EDIPTFT {
      *
      * \param level determine display illumination level (0 .. 255)
      */
-    void setDisplayIlluminationLevel(unsigned char level);
+    char setDisplayIlluminationLevel(unsigned char level);
 
     /*! \brief Acoustic confirmation of touch operations
      *
@@ -141,7 +541,7 @@ class EDIPTFT {
      *
      * \param on determine if buzzer should confirm touch operations
      */
-    void setTouchBuzzer(boolean on);
+    char setTouchBuzzer(boolean on);
     
     /*! \brief Sound buzzer
      *
@@ -149,7 +549,7 @@ class EDIPTFT {
      *
      * \param duration 1/10th seconds (0: off, 1: on, 2..255: on for 1/10th seconds)
      */
-    void soundBuzzer(unsigned char duration);
+    char soundBuzzer(unsigned char duration);
     
     /*! \brief Output port
      *
@@ -158,7 +558,7 @@ class EDIPTFT {
      * \param port  Port bit to modify (1..5/1..7); if set to 0, second parameter is bitmask to set
      * \param value 0: reset; 1: set; 2: toggle; if port is 0 this is the bitmask instead
      */
-    void setOutputPort(unsigned char port, unsigned char value);
+    char setOutputPort(unsigned char port, unsigned char value);
 
 
     /*! \brief Terminal on
@@ -167,7 +567,7 @@ class EDIPTFT {
      *
      * \param on determine if terminal is switched on
      */
-    void terminalOn(boolean on);
+    char terminalOn(boolean on);
 
     /*! \brief Load internal image
      *
@@ -178,7 +578,38 @@ class EDIPTFT {
      * \param y1 y position of image on the display
      * \param nr number of the image on the *EEPROM*
      */
-    void loadImage(int x1, int y1, int nr);
+    char loadImage(int x1, int y1, int nr);
+
+    /*! \brief Show an image sent from the controller
+     *
+     * Sends the BMP file in \a bmp to the display, which draws it at
+     * \a x1, \a y1. The file is read while it is sent, straight into the
+     * packets, so no RAM for the image is needed; use it with an SD card
+     * file or any other Stream. The packets are pipelined: the next one
+     * is filled while the previous one waits for its ACK.
+     *
+     * \return `EDIP_OK`, `EDIP_ERR_IMAGE` if \a bmp does not start with a
+     *         BMP header, `EDIP_ERR_TIMEOUT` if the stream ended early (the
+     *         rest is padded so the display stays in sync) or error code
+     */
+    char sendImage(int x1, int y1, Stream& bmp);
+
+    /*! \brief Show a BMP file from RAM
+     */
+    char sendImage(int x1, int y1, const char* bmp);
+
+#ifdef PROGMEM
+    /*! \brief Show a BMP file from flash (PROGMEM)
+     */
+    char sendImage_P(int x1, int y1, const char* bmp);
+#endif
+
+    /*! \brief Request a hardcopy of a screen area
+     *
+     * The display answers with a BMP file of the area from \a x1, \a y1
+     * to \a x2, \a y2 in its send buffer, see EDIPHardcopy.
+     */
+    char requestHardcopy(int x1, int y1, int x2, int y2);
 
     /*! \brief Cursor on/off
      *
@@ -186,7 +617,7 @@ class EDIPTFT {
      *
      * \param on `n1=0`: cursor is invisible, `n1=1`: cursor flashes
      */
-    void cursorOn(boolean on);
+    char cursorOn(boolean on);
 
     /*! \brief Position cursor
      *
@@ -195,7 +626,7 @@ class EDIPTFT {
      * \param col new cursor column
      * \param row new cursor row
      */
-    void setCursor(char col, char row);
+    char setCursor(char col, char row);
 
     // Bargraph
     /*! \brief Define bargraph
@@ -220,7 +651,7 @@ class EDIPTFT {
      *
      * \param mst additional parameter for type specification
      */
-    void defineBargraph(char dir, char no, int x1, int y1, int x2, int y2,
+    char defineBargraph(char dir, char no, int x1, int y1, int x2, int y2,
                         byte sv, byte ev, char type, char mst);
 
     /*! \brief Update bargraph
@@ -230,9 +661,9 @@ class EDIPTFT {
      * \param no number of the bargraph `1..32`
      * \param val new value of the bargraph
      */
-    void updateBargraph(char no, char val);
+    char updateBargraph(char no, char val);
 
-    void setBargraphColor(char no, char fg, char bg, char fr);
+    char setBargraphColor(char no, char fg, char bg, char fr);
 
     /*! \brief Set bargraph by touch
      *
@@ -240,9 +671,9 @@ class EDIPTFT {
      *
      * \param no number of the bargraph `1..32`
      */
-    void makeBargraphTouch(char no);
+    char makeBargraphTouch(char no);
 
-    void linkBargraphLight(char no);
+    char linkBargraphLight(char no);
 
     /*! \brief Delete bargraph
      *
@@ -255,17 +686,17 @@ class EDIPTFT {
      *           `n1=0`: bargraph remains visible\n
      *           `n1=1`: bargraph is deleted
      */
-    void deleteBargraph(char no, char n1);
+    char deleteBargraph(char no, char n1);
 
     // Instrument
-    void defineInstrument(char no, int x1, int y1, char image,
+    char defineInstrument(char no, int x1, int y1, char image,
                           char angle, char sv, char ev);
-    void updateInstrument(char no, char val);
-    void redrawInstrument(char no);
-    void deleteInstrument(char no, char n1, char n2);
+    char updateInstrument(char no, char val);
+    char redrawInstrument(char no);
+    char deleteInstrument(char no, char n1, char n2);
 
     // Text
-    void setTextColor(char fg, char bg);
+    char setTextColor(char fg, char bg);
 
     /*! \brief Set font
      *
@@ -273,7 +704,7 @@ class EDIPTFT {
      *
      * \param font font number `font=0..15`, use font defines here
      */
-    void setTextFont(char font);
+    char setTextFont(char font);
 
     /*! \brief Set text angle
      *
@@ -282,8 +713,10 @@ class EDIPTFT {
      * \param angle text output angle\n
                     `angle=0`: 0°
                     `angle=1`: 90°
+                    `angle=2`: 180°
+                    `angle=3`: 270°
      */
-    void setTextAngle(char angle);
+    char setTextAngle(char angle);
 
     /*! \brief Draw text on display
      *
@@ -299,50 +732,50 @@ class EDIPTFT {
      *                      `C`(enter)
      * \param text text to draw on display
      */
-    void drawText(int x1, int y1, char justification, const char* text);
+    char drawText(int x1, int y1, char justification, const char* text);
 
     // Rectangle and Line
-    void setLineColor(char fg, char bg);
+    char setLineColor(char fg, char bg);
 
     /*! \brief Point size/line thickness
      *
      * \param x x-point size (1..15)
      * \param y y-point size (1..15)
      */
-    void setLineThick(char x, char y);
+    char setLineThick(char x, char y);
 
     /*! \brief Draw straight line
      *
      * Draw straight line from point *x1*, *y1* to point *x2*, *y2*
      */
-    void drawLine(int x1, int y1, int x2, int y2);
+    char drawLine(int x1, int y1, int x2, int y2);
 
     /*! \brief Draw rectangle
      *
      * Draw four straight lines as a rectangle from *x1*, *y1* to *x2*, *y2*
      */
-    void drawRect(int x1, int y1, int x2, int y2);
+    char drawRect(int x1, int y1, int x2, int y2);
 
-    void drawRectf(int x1, int y1, int x2, int y2, char color);
+    char drawRectf(int x1, int y1, int x2, int y2, char color);
     
     /*! \brief Clear rectangle
      *
      * Clear rectangle from *x1*, *y1* to *x2*, *y2*
      */
-    void clearRect(int x1, int y1, int x2, int y2);
+    char clearRect(int x1, int y1, int x2, int y2);
 
     /*! \brief Invert rectangle
      *
      * Invert rectangle from *x1*, *y1* to *x2*, *y2*
      */
-    void invertRect(int x1, int y1, int x2, int y2);
+    char invertRect(int x1, int y1, int x2, int y2);
 
     /*! \brief Fill rectangle
      *
      * Fill rectangle from *x1*, *y1* to *x2*, *y2*
      */
-    void fillRect(int x1, int y1, int x2, int y2);
-    void fillRectp(int x1, int y1, int x2, int y2, char pattern);
+    char fillRect(int x1, int y1, int x2, int y2);
+    char fillRectp(int x1, int y1, int x2, int y2, char pattern);
     
 
     // Touch keys
@@ -359,7 +792,7 @@ class EDIPTFT {
      * \param up return/touchmacro (1-255) if released
      * \param text label of the touch key
      */
-    void defineTouchKey(int x1, int y1, int x2, int y2,
+    char defineTouchKey(int x1, int y1, int x2, int y2,
                         char down, char up, const char* text);
 
     /*! \brief Define touch switch
@@ -374,7 +807,7 @@ class EDIPTFT {
      * \param up return/touchmacro (1-255) if released
      * \param text label of the touch key
      */
-    void defineTouchSwitch(int x1, int y1, int x2, int y2,
+    char defineTouchSwitch(int x1, int y1, int x2, int y2,
                            char down, char up, const char* text);
 
     /*! \brief Define touch switch with image
@@ -389,7 +822,7 @@ class EDIPTFT {
      * \param up return/touchmacro (1-255) if released
      * \param text label of the touch switch
      */
-    void defineTouchSwitch(int x, int y, int img, char downcode,
+    char defineTouchSwitch(int x, int y, int img, char downcode,
                            char upcode, const char* text);
 
     /*! \brief Set touch switch
@@ -400,18 +833,18 @@ class EDIPTFT {
      * \param code Return code of the switch
      * \param value `value=0`: OFF, `value=1`: ON
      */
-    void setTouchSwitch(char code,char value);
+    char setTouchSwitch(char code,char value);
 
-    void setTouchkeyColors(char n1, char n2, char n3,
+    char setTouchkeyColors(char n1, char n2, char n3,
                            char s1, char s2, char s3);
 
     /*! \brief Label font
      *
      * Apply font with number *font* for touch key labels
      */
-    void setTouchkeyFont(char font);
+    char setTouchkeyFont(char font);
 
-    void setTouchkeyLabelColors(char nf,char sf);
+    char setTouchkeyLabelColors(char nf,char sf);
 
     /*! \brief Radio group for switches
      *
@@ -422,7 +855,7 @@ class EDIPTFT {
      * For switches only the *down code* is applicable. The *up code* will be
      * ignored.
      */
-    void setTouchGroup(char group);
+    char setTouchGroup(char group);
 
     /*! \brief Delete toch area by up- or downcode
      *
@@ -432,26 +865,26 @@ class EDIPTFT {
      *  \param n1 n1==0: the area remains visible on the display,
      *            n1==1: the area is deleted
      */
-    void removeTouchArea(char code,char n1);
+    char removeTouchArea(char code,char n1);
 
     // Macro Calls
     /*! \brief Run macro
      *
      * Call the (normal) macro with number *nr* (max. 7 levels).
      */
-    void callMacro(uint nr);
+    char callMacro(uint nr);
 
     /*! \brief Run touch macro
      *
      * Call touch macro with number *nr* (max. 7 levels)
      */
-    void callTouchMacro(uint nr);
+    char callTouchMacro(uint nr);
 
     /*! \brief Run menu macro
      *
      * Call menu macro with number *nr* (max. 7 levels)
      */
-    void callMenuMacro(uint nr);
+    char callMenuMacro(uint nr);
 
     /*! \brief Define touch key with menu function
      *
@@ -466,7 +899,7 @@ class EDIPTFT {
      *                menu item
      * \param text string with the key text and menu items
      */
-    void defineTouchMenu(int x1, int y1, int x2, int y2,
+    char defineTouchMenu(int x1, int y1, int x2, int y2,
                          char downcode, char upcode, char mnucode,
                          const char *text);
 
@@ -475,13 +908,13 @@ class EDIPTFT {
      *  If a touch menu is not set to open automatically the TFT sends a
      *  request 'ESC T 0'. This function sends 'ESC N T 2' to open the menu.
      */
-    void openTouchMenu();
+    char openTouchMenu();
 
     /*! \brief Set menu font
      *
      * Set font with number *font* (`0..15`) for menu display
      */
-    void setMenuFont(char font);
+    char setMenuFont(char font);
 
     /*! \brief enable/disable touchmenu automation
      *
@@ -489,14 +922,140 @@ class EDIPTFT {
      * doesn' t open automatically, instead a request is sent to the
      * host computer, which can then open the menu with openTouchMenu()
      */
-    void setTouchMenuAutomation(bool val);
+    char setTouchMenuAutomation(bool val);
 
   private:
+    EDIPTransport* _transport;
     boolean _smallprotocol;
+    unsigned char _coordSize;
+    long _baud;
+    unsigned char _packetSize;
+    boolean _batching;
+    unsigned int _batchTimeout;
+    unsigned long _batchStart;
+    unsigned char _packetLen;
+    unsigned char _packetBcc;
+    boolean _async;
+    boolean _txWaiting;
+    unsigned char _txHead;
+    unsigned char _txCount;
+    unsigned int _txNextSeq;
+    // whole frames: DC1, length, data, checksum
+    char _txData[EDIPTFT_TX_SLOTS][EDIPTFT_PACKET_SIZE + 3];
+    unsigned char _txLen[EDIPTFT_TX_SLOTS];
+    unsigned int _txSeq[EDIPTFT_TX_SLOTS];
+    unsigned char _txStatus[EDIPTFT_TX_HISTORY];
+    boolean _txBackoff;
+    unsigned char _txTries;
+    unsigned long _txSentAt;
+    unsigned long _txResendAt;
+    unsigned int _txFailed;
+    unsigned int _cmdFailed;
+    char* _recBuffer;
+    unsigned int _recSize;
+    unsigned int _recLen;
+    boolean _recOverflow;
+    struct Shape {
+      unsigned char kind;
+      char color;
+      int x1, y1, x2, y2;
+    };
+    boolean _geoEnabled;
+    unsigned char _geoCount;
+    Shape _geo[EDIPTFT_GEOMETRY_QUEUE];
+    boolean queueShape(unsigned char kind, int x1, int y1, int x2,
+                       int y2, char color=0);
+    boolean mergeShape(Shape& a, const Shape& b);
+    boolean covers(const Shape& a, const Shape& b);
+    void putGeometry();
+#ifdef EDIPTFT_STATS
+    EDIPStats _stats;
+    unsigned long _statSentAt;
+    void countLatency(unsigned char family);
+#endif
+    char beginImage(int x1, int y1, const char* header);
+    char endImage(boolean async);
+    boolean _shadowEnabled;
+    unsigned long _shadowValid;
+    char _shadow[EDIPTFT_SHADOW_SIZE];
+    unsigned int _valueInterval;
+    unsigned long _valuesSent;
+    unsigned long _barDirty;
+    unsigned long _barKnown;
+    char _barPending[EDIPTFT_BARGRAPHS];
+    char _barShown[EDIPTFT_BARGRAPHS];
+    unsigned long _instDirty;
+    unsigned long _instKnown;
+    char _instPending[EDIPTFT_INSTRUMENTS];
+    char _instShown[EDIPTFT_INSTRUMENTS];
+    char _lastError;
+    unsigned int _ackTimeout;
+    unsigned char _maxRetries;
+    unsigned int _retryDelay;
+    unsigned char _rxState;
+    unsigned char _rxType;
+    unsigned char _rxLen;
+    unsigned char _rxPos;
+    unsigned char _rxBcc;
+    char _rxExpect;
+    boolean _rxExpectAck;
+    unsigned char _rxAck;
+    int _rxResult;
+    unsigned long _rxLast;
+    char _rxData[EDIPTFT_RX_SIZE];
+    void init(boolean smallprotocol, unsigned char coordSize);
+    void beginCommand();
+    void put(char c);
+    void putData(const char* data, size_t len);
+    void putText(const char* text);
+    void openPacket();
+    char endCommand();
+    boolean cached(unsigned char item, const char* values, unsigned char len);
+    char flushValuesIfDue();
+    void coalesce(char* pending, const char* shown, unsigned long& dirty,
+                  unsigned long known, unsigned char i, char val);
+    void putValues(char group, const char* pending, char* shown,
+                   unsigned long& dirty, unsigned long& known,
+                   unsigned char count);
+    void forgetValue(unsigned long& mask, unsigned char i);
+    char* putCoord(char* p, int value);
+    char* putPoint(char* p, int x, int y);
+    char* putRect(char* p, int x1, int y1, int x2, int y2);
     unsigned char bytesAvailable();
-    void waitBytesAvailable();
+    boolean waitBytesAvailable();
     void sendByte(char data);
-    void sendSmall(char* data, char len);
-    void sendSmallDC2(char* data, char len);
+    void sendFrame(const char* frame, unsigned char len);
+    unsigned char txTail();
+    void serviceTx();
+    void txDone(unsigned char status);
+    void waitTxIdle();
+    unsigned int retryBackoff(unsigned char tries);
+    char waitAck();
+    char sendSmallDC2(char* data, char len, char response=0);
+    void expectAck();
+    void receiveByte(unsigned char c);
+    int waitResponse();
+    int request(char* command, char len, char response);
+    static char baudCode(long baud);
+    char checkLink();
+};
+
+
+/*! \brief Display with device traits
+ *
+ * EDIPTFT for the display family \a Device, so displays with 1 and 2 byte
+ * coordinates can be driven from the same firmware:
+ *
+ *     EDIPDisplay<EDIP240Device> small(port1);
+ *     EDIPDisplay<EDIPTFT43Device> large(port2);
+ */
+template <class Device>
+class EDIPDisplay : public EDIPTFT {
+  public:
+    static const int width = Device::width;
+    static const int height = Device::height;
+
+    EDIPDisplay(EDIPTransport& transport, boolean smallprotocol=true)
+      : EDIPTFT(transport, smallprotocol, Device::coordSize) {}
 };
 #endif
@@ -0,0 +1,363 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPTrace.h"
+
+// "EDIPTRAC" and the version
+#define HEADER_SIZE 9
+static const char header[HEADER_SIZE] = {
+  'E', 'D', 'I', 'P', 'T', 'R', 'A', 'C', 1
+};
+
+// kind, length, time; unsigned like the lengths it is added to
+#define RECORD_HEAD 6U
+
+
+EDIPTrace::EDIPTrace(EDIPTransport& port, char* buffer, unsigned int size) {
+  _port = &port;
+  _sink = 0;
+  _header = true;
+  _buffer = buffer;
+  _size = size;
+  clear();
+}
+
+
+EDIPTrace::EDIPTrace(EDIPTransport& port, Print& sink) {
+  _port = &port;
+  _sink = &sink;
+  // written with the first record, the sink may not be open yet
+  _header = false;
+  _buffer = 0;
+  _size = 0;
+  clear();
+}
+
+
+void EDIPTrace::begin(long baud) {
+  char data[4];
+
+  data[0] = baud;
+  data[1] = baud >> 8;
+  data[2] = baud >> 16;
+  data[3] = baud >> 24;
+  flush();
+  collect(EDIPTRACE_BAUD, data, sizeof(data));
+  flush();
+  _port->begin(baud);
+}
+
+
+size_t EDIPTrace::write(const char* buf, size_t len) {
+  collect(EDIPTRACE_TX, buf, len);
+  return _port->write(buf, len);
+}
+
+
+int EDIPTrace::available() {
+  // the library polls for the answer when a packet is complete
+  if (_kind == EDIPTRACE_TX) {
+    flush();
+  }
+  return _port->available();
+}
+
+
+int EDIPTrace::read() {
+  int c = _port->read();
+  char data;
+
+  if (c >= 0) {
+    data = c;
+    collect(EDIPTRACE_RX, &data, 1);
+  }
+  return c;
+}
+
+
+bool EDIPTrace::requests() {
+  return _port->requests();
+}
+
+
+char EDIPTrace::commandDone() {
+  return _port->commandDone();
+}
+
+
+void EDIPTrace::collect(char kind, const char* data, size_t len) {
+  size_t chunk;
+
+  if (kind != _kind) {
+    flush();
+  }
+  while (len > 0) {
+    if (_pendingLen == 0) {
+      _kind = kind;
+      _time = micros() - _start;
+    }
+    chunk = EDIPTRACE_RECORD_SIZE - _pendingLen;
+    if (chunk > len) {
+      chunk = len;
+    }
+    memcpy(_pending + _pendingLen, data, chunk);
+    _pendingLen += chunk;
+    data += chunk;
+    len -= chunk;
+    if (_pendingLen == EDIPTRACE_RECORD_SIZE) {
+      flush();
+    }
+  }
+}
+
+
+void EDIPTrace::flush() {
+  char head[RECORD_HEAD];
+
+  if (_pendingLen == 0) {
+    _kind = 0;
+    return;
+  }
+  head[0] = _kind;
+  head[1] = _pendingLen;
+  head[2] = _time;
+  head[3] = _time >> 8;
+  head[4] = _time >> 16;
+  head[5] = _time >> 24;
+  if (_sink) {
+    if (!_header) {
+      _sink->write((const uint8_t*)header, HEADER_SIZE);
+      _header = true;
+    }
+    _sink->write((const uint8_t*)head, RECORD_HEAD);
+    _sink->write((const uint8_t*)_pending, _pendingLen);
+  }
+  else if (RECORD_HEAD + _pendingLen > _size) {
+    _dropped++;
+  }
+  else {
+    // make room by dropping the oldest records
+    while (_size - _len < RECORD_HEAD + _pendingLen) {
+      unsigned int oldest =
+          RECORD_HEAD + (unsigned char)_buffer[(_head + 1) % _size];
+      _head = (_head + oldest) % _size;
+      _len -= oldest;
+      _dropped++;
+    }
+    store(head, RECORD_HEAD);
+    store(_pending, _pendingLen);
+  }
+  _pendingLen = 0;
+  _kind = 0;
+}
+
+
+void EDIPTrace::store(const char* data, unsigned int len) {
+  unsigned int pos = (_head + _len) % _size;
+  unsigned int chunk = _size - pos;
+
+  if (chunk > len) {
+    chunk = len;
+  }
+  memcpy(_buffer + pos, data, chunk);
+  memcpy(_buffer, data + chunk, len - chunk);
+  _len += len;
+}
+
+
+void EDIPTrace::dump(Print& out) {
+  unsigned int chunk;
+
+  flush();
+  out.write((const uint8_t*)header, HEADER_SIZE);
+  if (_len == 0) {
+    return;
+  }
+  chunk = _size - _head;
+  if (chunk > _len) {
+    chunk = _len;
+  }
+  out.write((const uint8_t*)_buffer + _head, chunk);
+  out.write((const uint8_t*)_buffer, _len - chunk);
+}
+
+
+void EDIPTrace::clear() {
+  _head = 0;
+  _len = 0;
+  _dropped = 0;
+  _kind = 0;
+  _pendingLen = 0;
+  _start = micros();
+}
+
+
+unsigned int EDIPTrace::length() {
+  return _len;
+}
+
+
+unsigned long EDIPTrace::dropped() {
+  return _dropped;
+}
+
+
+EDIPTraceReplay::EDIPTraceReplay(EDIPTransport& target) {
+  _target = &target;
+  _records = 0;
+  _missing = 0;
+  _mismatched = 0;
+  _recorded = 0;
+  _elapsed = 0;
+}
+
+
+// Read \a len bytes of a trace, false if it ends before
+static boolean readTrace(Stream& trace, char* data, unsigned int len) {
+  unsigned int i;
+  int c;
+
+  for (i = 0; i < len; i++) {
+    c = trace.read();
+    if (c < 0) {
+      return false;
+    }
+    data[i] = c;
+  }
+  return true;
+}
+
+
+static unsigned long get32(const char* data) {
+  return (unsigned long)(unsigned char)data[0] |
+         (unsigned long)(unsigned char)data[1] << 8 |
+         (unsigned long)(unsigned char)data[2] << 16 |
+         (unsigned long)(unsigned char)data[3] << 24;
+}
+
+
+boolean EDIPTraceReplay::play(Stream& trace, unsigned int speed) {
+  char head[HEADER_SIZE];
+  char data[255];
+  unsigned long start, first = 0, at;
+  unsigned char len;
+
+  _records = 0;
+  _missing = 0;
+  _mismatched = 0;
+  _recorded = 0;
+  _elapsed = 0;
+  if (!readTrace(trace, head, HEADER_SIZE) ||
+      memcmp(head, header, HEADER_SIZE) != 0) {
+    return false;
+  }
+  start = micros();
+  while (trace.peek() >= 0) {
+    if (!readTrace(trace, head, RECORD_HEAD)) {
+      return false;
+    }
+    len = head[1];
+    if (!readTrace(trace, data, len)) {
+      return false;
+    }
+    if (_records == 0) {
+      first = get32(head + 2);
+    }
+    at = get32(head + 2) - first;
+    _recorded = at;
+    switch (head[0]) {
+      case EDIPTRACE_TX:
+        if (speed > 0) {
+          waitUntil(start, (unsigned long long)at * 100 / speed);
+        }
+        _target->write(data, len);
+        break;
+      case EDIPTRACE_RX:
+        expect(data, len);
+        break;
+      case EDIPTRACE_BAUD:
+        if (len == 4) {
+          _target->begin(get32(data));
+        }
+        break;
+    }
+    _records++;
+  }
+  _elapsed = micros() - start;
+  return true;
+}
+
+
+void EDIPTraceReplay::waitUntil(unsigned long start, unsigned long due) {
+  unsigned long now;
+
+  while ((now = micros() - start) < due) {
+    if (due - now >= 1000) {
+      delay((due - now) / 1000);
+    }
+  }
+}
+
+
+void EDIPTraceReplay::expect(const char* data, unsigned char len) {
+  unsigned long start = millis();
+  unsigned char i = 0;
+
+  while (i < len) {
+    if (_target->available() > 0) {
+      if ((char)_target->read() != data[i]) {
+        _mismatched++;
+      }
+      i++;
+    }
+    else if (millis() - start >= EDIPTRACE_TIMEOUT) {
+      _missing += len - i;
+      break;
+    }
+  }
+}
+
+
+unsigned long EDIPTraceReplay::records() {
+  return _records;
+}
+
+
+unsigned long EDIPTraceReplay::missing() {
+  return _missing;
+}
+
+
+unsigned long EDIPTraceReplay::mismatched() {
+  return _mismatched;
+}
+
+
+unsigned long EDIPTraceReplay::recorded() {
+  return _recorded;
+}
+
+
+unsigned long EDIPTraceReplay::elapsed() {
+  return _elapsed;
+}
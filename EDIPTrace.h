@@ -0,0 +1,173 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPTrace_h
+#define EDIPTrace_h
+
+#include "EDIPTFT.h"
+
+// Bytes of one direction that are collected into a single record
+// (max. 255, the length field of a record is one byte)
+#ifndef EDIPTRACE_RECORD_SIZE
+#define EDIPTRACE_RECORD_SIZE 64
+#endif
+#if EDIPTRACE_RECORD_SIZE > 255
+#error "EDIPTRACE_RECORD_SIZE must not be larger than 255"
+#endif
+
+// ms the replay waits for a recorded response
+#ifndef EDIPTRACE_TIMEOUT
+#define EDIPTRACE_TIMEOUT 500
+#endif
+
+// Record kinds
+#define EDIPTRACE_TX 'T'    // bytes sent to the display
+#define EDIPTRACE_RX 'R'    // bytes received from the display
+#define EDIPTRACE_BAUD 'B'  // begin(), 4 bytes baud rate
+
+/*! \brief Transport that records the traffic of another transport
+ *
+ * Put it between EDIPTFT and the port. Every run of bytes in one
+ * direction becomes a record with the time in µs since the start of the
+ * trace, either in a ring buffer, which keeps the newest records, or
+ * written to a sink, e.g. a second serial port or a file on an SD card:
+ *
+ *     EDIPSerialTransport<HardwareSerial> port(Serial1);
+ *     char traceBuffer[2048];
+ *     EDIPTrace trace(port, traceBuffer, sizeof(traceBuffer));
+ *     EDIPTFT tft(trace);
+ *     ...
+ *     trace.dump(Serial);  // after something went wrong
+ *
+ * A trace starts with "EDIPTRAC" and a version byte, followed by the
+ * records: kind, data length, time (4 bytes, LSB first), data. Replay it
+ * with EDIPTraceReplay or `extras/trace`.
+ */
+class EDIPTrace : public EDIPTransport {
+  public:
+    /*! \brief Trace \a port into a ring buffer
+     */
+    EDIPTrace(EDIPTransport& port, char* buffer, unsigned int size);
+
+    /*! \brief Trace \a port into \a sink
+     */
+    EDIPTrace(EDIPTransport& port, Print& sink);
+
+    void begin(long baud);
+    size_t write(const char* buf, size_t len);
+    int available();
+    int read();
+    bool requests();
+    char commandDone();
+
+    /*! \brief Finish the record that is being collected
+     */
+    void flush();
+
+    /*! \brief Write the ring buffer as a trace to \a out
+     */
+    void dump(Print& out);
+
+    /*! \brief Empty the ring buffer and restart the time
+     */
+    void clear();
+
+    /*! \brief Bytes in the ring buffer
+     */
+    unsigned int length();
+
+    /*! \brief Records that were overwritten or did not fit
+     */
+    unsigned long dropped();
+
+  private:
+    EDIPTransport* _port;
+    Print* _sink;
+    boolean _header;
+    char* _buffer;
+    unsigned int _size;
+    unsigned int _head;
+    unsigned int _len;
+    unsigned long _dropped;
+    unsigned long _start;
+    char _kind;
+    unsigned long _time;
+    unsigned char _pendingLen;
+    char _pending[EDIPTRACE_RECORD_SIZE];
+    void collect(char kind, const char* data, size_t len);
+    void store(const char* data, unsigned int len);
+};
+
+/*! \brief Plays a trace into a transport
+ *
+ * Sends the recorded bytes at their recorded time, scaled by \a speed
+ * in percent: 100 is the original speed, 200 twice as fast. With speed
+ * 0 the bytes are sent as soon as the responses recorded before them
+ * have arrived, which measures how fast the display can take the
+ * traffic. Responses are always waited for (up to EDIPTRACE_TIMEOUT)
+ * and compared with the recording.
+ *
+ *     EDIPTraceReplay replay(port);
+ *     replay.play(file, 100);
+ */
+class EDIPTraceReplay {
+  public:
+    EDIPTraceReplay(EDIPTransport& target);
+
+    /*! \brief Play the trace in \a trace
+     *
+     * \return false if \a trace is not a trace or is truncated
+     */
+    boolean play(Stream& trace, unsigned int speed=100);
+
+    /*! \brief Records played
+     */
+    unsigned long records();
+
+    /*! \brief Recorded response bytes that did not arrive
+     */
+    unsigned long missing();
+
+    /*! \brief Received bytes that differ from the recording
+     */
+    unsigned long mismatched();
+
+    /*! \brief µs from the first to the last record in the trace
+     */
+    unsigned long recorded();
+
+    /*! \brief µs the replay took
+     */
+    unsigned long elapsed();
+
+  private:
+    EDIPTransport* _target;
+    unsigned long _records;
+    unsigned long _missing;
+    unsigned long _mismatched;
+    unsigned long _recorded;
+    unsigned long _elapsed;
+    void waitUntil(unsigned long start, unsigned long due);
+    void expect(const char* data, unsigned char len);
+};
+#endif
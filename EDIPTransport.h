@@ -0,0 +1,120 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPTransport_h
+#define EDIPTransport_h
+
+#include <stddef.h>
+
+/*! \brief Byte transport to the display
+ *
+ * Implement this interface to connect EDIPTFT to something other than an
+ * Arduino serial port, e.g. a DMA UART driver or a serial port on a host.
+ */
+class EDIPTransport {
+  public:
+    virtual ~EDIPTransport() {}
+
+    /*! \brief Open the connection with \a baud bits per second
+     *
+     * Called by EDIPTFT::begin(). Transports without a baud rate can
+     * ignore it.
+     */
+    virtual void begin(long /*baud*/) {}
+
+    /*! \brief Send \a len bytes from \a buf
+     *
+     * With the small protocol EDIPTFT passes each packet as one
+     * complete frame that stays valid until the display acknowledged
+     * it, so a DMA transport can start the transfer and return.
+     *
+     * \return number of bytes written
+     */
+    virtual size_t write(const char* buf, size_t len) = 0;
+
+    /*! \brief Number of received bytes that can be read without waiting
+     */
+    virtual int available() = 0;
+
+    /*! \brief Read one received byte
+     *
+     * \return the byte or -1 if nothing is available
+     */
+    virtual int read() = 0;
+
+    /*! \brief Whether responses of the display can be read
+     *
+     * EDIPTFT fails requests (readBuffer(), ...) with
+     * `EDIP_ERR_UNSUPPORTED` on transports that only send.
+     */
+    virtual bool requests() {
+      return true;
+    }
+
+    /*! \brief Called after the last byte of each command
+     *
+     * Only without the small protocol. Transports that queue the bytes
+     * can drop a command they could not queue completely, so the display
+     * never gets half of it.
+     *
+     * \return 0 (`EDIP_OK`) or the error that dropped the command
+     */
+    virtual char commandDone() {
+      return 0;
+    }
+};
+
+
+/*! \brief Transport for Arduino serial ports
+ *
+ * Works with every port class that has `begin(baud)`, `write()`,
+ * `available()` and `read()`, e.g. `HardwareSerial` or `SoftwareSerial`:
+ *
+ *     EDIPSerialTransport<HardwareSerial> port(Serial1);
+ *     EDIPTFT tft(port);
+ */
+template <class Port>
+class EDIPSerialTransport : public EDIPTransport {
+  public:
+    EDIPSerialTransport(Port& port) : _port(port) {}
+
+    void begin(long baud) {
+      _port.begin(baud);
+    }
+
+    size_t write(const char* buf, size_t len) {
+      return _port.write((const uint8_t*)buf, len);
+    }
+
+    int available() {
+      return _port.available();
+    }
+
+    int read() {
+      return _port.read();
+    }
+
+  private:
+    Port& _port;
+};
+#endif
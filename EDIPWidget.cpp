@@ -0,0 +1,330 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPWidget.h"
+
+
+EDIPWidget::EDIPWidget() {
+  _dirty = true;
+  _drawn = false;
+  _next = 0;
+}
+
+
+boolean EDIPWidget::dirty() {
+  return _dirty;
+}
+
+
+void EDIPWidget::invalidate() {
+  _dirty = true;
+}
+
+
+void EDIPWidget::changed() {
+  _dirty = true;
+}
+
+
+void EDIPWidget::setText(char* dest, const char* text) {
+  if (strncmp(dest, text, EDIPWIDGET_TEXT_SIZE - 1) != 0) {
+    strncpy(dest, text, EDIPWIDGET_TEXT_SIZE - 1);
+    dest[EDIPWIDGET_TEXT_SIZE - 1] = 0;
+    changed();
+  }
+}
+
+
+EDIPLabel::EDIPLabel(int x1, int y1, int x2, int y2, char justification,
+                     char font, char fg, char bg, const char* text) {
+  _x1 = x1;
+  _y1 = y1;
+  _x2 = x2;
+  _y2 = y2;
+  _justification = justification;
+  _font = font;
+  _fg = fg;
+  _bg = bg;
+  _text[0] = 0;
+  EDIPWidget::setText(_text, text);
+}
+
+
+void EDIPLabel::setText(const char* text) {
+  EDIPWidget::setText(_text, text);
+}
+
+
+void EDIPLabel::setColor(char fg, char bg) {
+  if (fg != _fg || bg != _bg) {
+    _fg = fg;
+    _bg = bg;
+    changed();
+  }
+}
+
+
+void EDIPLabel::setFont(char font) {
+  if (font != _font) {
+    _font = font;
+    changed();
+  }
+}
+
+
+char EDIPLabel::draw(EDIPTFT& tft) {
+  int x = _x1;
+  char result;
+
+  if (_justification == 'C') {
+    x = (_x1 + _x2) / 2;
+  }
+  else if (_justification == 'R') {
+    x = _x2;
+  }
+  result = tft.clearRect(_x1, _y1, _x2, _y2);
+  if (result == EDIP_OK) {
+    result = tft.setTextFont(_font);
+  }
+  if (result == EDIP_OK) {
+    result = tft.setTextColor(_fg, _bg);
+  }
+  if (result == EDIP_OK && _text[0]) {
+    result = tft.drawText(x, _y1, _justification, _text);
+  }
+  return result;
+}
+
+
+EDIPRectangle::EDIPRectangle(int x1, int y1, int x2, int y2, char color) {
+  _x1 = x1;
+  _y1 = y1;
+  _x2 = x2;
+  _y2 = y2;
+  _color = color;
+  _moved = false;
+}
+
+
+void EDIPRectangle::setBounds(int x1, int y1, int x2, int y2) {
+  if (x1 == _x1 && y1 == _y1 && x2 == _x2 && y2 == _y2) {
+    return;
+  }
+  if (_drawn && !_moved) {
+    _oldX1 = _x1;
+    _oldY1 = _y1;
+    _oldX2 = _x2;
+    _oldY2 = _y2;
+    _moved = true;
+  }
+  _x1 = x1;
+  _y1 = y1;
+  _x2 = x2;
+  _y2 = y2;
+  changed();
+}
+
+
+void EDIPRectangle::setColor(char color) {
+  if (color != _color) {
+    _color = color;
+    changed();
+  }
+}
+
+
+char EDIPRectangle::draw(EDIPTFT& tft) {
+  char result = EDIP_OK;
+  if (_moved) {
+    result = tft.clearRect(_oldX1, _oldY1, _oldX2, _oldY2);
+    _moved = false;
+  }
+  if (result == EDIP_OK) {
+    result = tft.drawRectf(_x1, _y1, _x2, _y2, _color);
+  }
+  return result;
+}
+
+
+EDIPBargraph::EDIPBargraph(char dir, char no, int x1, int y1, int x2, int y2,
+                           byte sv, byte ev, char type, char mst) {
+  _dir = dir;
+  _no = no;
+  _x1 = x1;
+  _y1 = y1;
+  _x2 = x2;
+  _y2 = y2;
+  _sv = sv;
+  _ev = ev;
+  _type = type;
+  _mst = mst;
+  _value = sv;
+}
+
+
+void EDIPBargraph::setValue(char val) {
+  if (val != _value) {
+    _value = val;
+    changed();
+  }
+}
+
+
+void EDIPBargraph::invalidate() {
+  _drawn = false;
+  changed();
+}
+
+
+char EDIPBargraph::draw(EDIPTFT& tft) {
+  char result = EDIP_OK;
+  if (!_drawn) {
+    result = tft.defineBargraph(_dir, _no, _x1, _y1, _x2, _y2, _sv, _ev,
+                                _type, _mst);
+  }
+  if (result == EDIP_OK) {
+    result = tft.updateBargraph(_no, _value);
+  }
+  return result;
+}
+
+
+EDIPInstrument::EDIPInstrument(char no, int x1, int y1, char image,
+                               char angle, char sv, char ev) {
+  _no = no;
+  _x1 = x1;
+  _y1 = y1;
+  _image = image;
+  _angle = angle;
+  _sv = sv;
+  _ev = ev;
+  _value = sv;
+}
+
+
+void EDIPInstrument::setValue(char val) {
+  if (val != _value) {
+    _value = val;
+    changed();
+  }
+}
+
+
+void EDIPInstrument::invalidate() {
+  _drawn = false;
+  changed();
+}
+
+
+char EDIPInstrument::draw(EDIPTFT& tft) {
+  char result = EDIP_OK;
+  if (!_drawn) {
+    result = tft.defineInstrument(_no, _x1, _y1, _image, _angle, _sv, _ev);
+  }
+  if (result == EDIP_OK) {
+    result = tft.updateInstrument(_no, _value);
+  }
+  return result;
+}
+
+
+EDIPTouchKey::EDIPTouchKey(int x1, int y1, int x2, int y2, char down,
+                           char up, const char* text) {
+  _x1 = x1;
+  _y1 = y1;
+  _x2 = x2;
+  _y2 = y2;
+  _down = down;
+  _up = up;
+  _text[0] = 0;
+  EDIPWidget::setText(_text, text);
+}
+
+
+void EDIPTouchKey::setText(const char* text) {
+  EDIPWidget::setText(_text, text);
+}
+
+
+char EDIPTouchKey::draw(EDIPTFT& tft) {
+  char result = EDIP_OK;
+  // code 0 would remove all touch areas
+  char code = _down ? _down : _up;
+  if (_drawn && code) {
+    result = tft.removeTouchArea(code, 1);
+  }
+  if (result == EDIP_OK) {
+    result = tft.defineTouchKey(_x1, _y1, _x2, _y2, _down, _up, _text);
+  }
+  return result;
+}
+
+
+EDIPScreen::EDIPScreen(EDIPTFT& tft) : _tft(tft) {
+  _first = 0;
+  _last = 0;
+}
+
+
+void EDIPScreen::add(EDIPWidget& widget) {
+  widget._next = 0;
+  if (_last) {
+    _last->_next = &widget;
+  }
+  else {
+    _first = &widget;
+  }
+  _last = &widget;
+  widget.invalidate();
+}
+
+
+char EDIPScreen::render() {
+  char result = EDIP_OK;
+  char error;
+  EDIPWidget* widget;
+
+  for (widget = _first; widget; widget = widget->_next) {
+    if (widget->_dirty) {
+      error = widget->draw(_tft);
+      if (error == EDIP_OK) {
+        widget->_dirty = false;
+        widget->_drawn = true;
+      }
+      else if (result == EDIP_OK) {
+        result = error;
+      }
+    }
+  }
+  error = _tft.flush();
+  return result != EDIP_OK ? result : error;
+}
+
+
+void EDIPScreen::invalidate() {
+  EDIPWidget* widget;
+  for (widget = _first; widget; widget = widget->_next) {
+    widget->invalidate();
+    widget->_drawn = false;
+  }
+}
@@ -0,0 +1,237 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPWidget_h
+#define EDIPWidget_h
+
+#include "EDIPTFT.h"
+
+// Maximum text length of labels and touch keys (including the NUL)
+#ifndef EDIPWIDGET_TEXT_SIZE
+#define EDIPWIDGET_TEXT_SIZE 32
+#endif
+
+/*! \brief Element of a retained-mode screen
+ *
+ * A widget keeps its properties and only sends commands to the display
+ * when one of them changed since the last EDIPScreen::render(). Widgets are
+ * normally global or static objects; nothing is allocated dynamically.
+ * Widgets on one screen must not overlap.
+ */
+class EDIPWidget {
+  public:
+    EDIPWidget();
+    virtual ~EDIPWidget() {}
+
+    /*! \brief true if the widget is redrawn by the next render()
+     */
+    boolean dirty();
+
+    /*! \brief Redraw the widget completely with the next render()
+     */
+    virtual void invalidate();
+
+  protected:
+    friend class EDIPScreen;
+
+    /*! \brief Send the commands for all changes
+     */
+    virtual char draw(EDIPTFT& tft) = 0;
+
+    void changed();
+    void setText(char* dest, const char* text);
+
+    boolean _dirty;
+    boolean _drawn;
+
+  private:
+    EDIPWidget* _next;
+};
+
+
+/*! \brief Text in a box
+ *
+ * The box is cleared before the text is redrawn, so it should cover the
+ * longest text. The text is aligned to the left edge, center or right
+ * edge of the box according to \a justification (`L`, `C`, `R`).
+ */
+class EDIPLabel : public EDIPWidget {
+  public:
+    EDIPLabel(int x1, int y1, int x2, int y2, char justification,
+              char font, char fg, char bg, const char* text="");
+
+    void setText(const char* text);
+    void setColor(char fg, char bg);
+    void setFont(char font);
+
+  protected:
+    char draw(EDIPTFT& tft);
+
+  private:
+    int _x1, _y1, _x2, _y2;
+    char _justification;
+    char _font;
+    char _fg, _bg;
+    char _text[EDIPWIDGET_TEXT_SIZE];
+};
+
+
+/*! \brief Filled rectangle
+ */
+class EDIPRectangle : public EDIPWidget {
+  public:
+    EDIPRectangle(int x1, int y1, int x2, int y2, char color);
+
+    /*! \brief Move or resize the rectangle
+     *
+     * The old area is cleared with the next render().
+     */
+    void setBounds(int x1, int y1, int x2, int y2);
+    void setColor(char color);
+
+  protected:
+    char draw(EDIPTFT& tft);
+
+  private:
+    int _x1, _y1, _x2, _y2;
+    int _oldX1, _oldY1, _oldX2, _oldY2;
+    boolean _moved;
+    char _color;
+};
+
+
+/*! \brief Bargraph, see EDIPTFT::defineBargraph()
+ *
+ * The bargraph is defined with the first render(), afterwards only value
+ * changes are sent.
+ */
+class EDIPBargraph : public EDIPWidget {
+  public:
+    EDIPBargraph(char dir, char no, int x1, int y1, int x2, int y2,
+                 byte sv, byte ev, char type, char mst);
+
+    void setValue(char val);
+    void invalidate();
+
+  protected:
+    char draw(EDIPTFT& tft);
+
+  private:
+    char _dir, _no;
+    int _x1, _y1, _x2, _y2;
+    byte _sv, _ev;
+    char _type, _mst;
+    char _value;
+};
+
+
+/*! \brief Instrument, see EDIPTFT::defineInstrument()
+ *
+ * The instrument is defined with the first render(), afterwards only value
+ * changes are sent.
+ */
+class EDIPInstrument : public EDIPWidget {
+  public:
+    EDIPInstrument(char no, int x1, int y1, char image, char angle,
+                   char sv, char ev);
+
+    void setValue(char val);
+    void invalidate();
+
+  protected:
+    char draw(EDIPTFT& tft);
+
+  private:
+    char _no;
+    int _x1, _y1;
+    char _image, _angle, _sv, _ev;
+    char _value;
+};
+
+
+/*! \brief Touch key, see EDIPTFT::defineTouchKey()
+ *
+ * Drawn with the touch key font and colors that are active when the key is
+ * rendered. A changed label removes the key by its \a down code (\a up if
+ * \a down is 0) and redefines it; a key with both codes 0 is only
+ * redefined.
+ */
+class EDIPTouchKey : public EDIPWidget {
+  public:
+    EDIPTouchKey(int x1, int y1, int x2, int y2, char down, char up,
+                 const char* text);
+
+    void setText(const char* text);
+
+  protected:
+    char draw(EDIPTFT& tft);
+
+  private:
+    int _x1, _y1, _x2, _y2;
+    char _down, _up;
+    char _text[EDIPWIDGET_TEXT_SIZE];
+};
+
+
+/*! \brief Set of widgets shown together on a display
+ *
+ *     EDIPScreen screen(tft);
+ *     EDIPLabel voltage(0, 0, 79, 9, 'R', EA_FONT6X8, EA_WHITE, EA_BLACK);
+ *     screen.add(voltage);
+ *     ...
+ *     voltage.setText("12.5V");
+ *     screen.render();  // sends only the changed label
+ *
+ * render() works best with EDIPTFT::setStateCache() and
+ * EDIPTFT::setBatching() enabled.
+ */
+class EDIPScreen {
+  public:
+    EDIPScreen(EDIPTFT& tft);
+
+    /*! \brief Add \a widget to the screen
+     *
+     * A widget can only be on one screen.
+     */
+    void add(EDIPWidget& widget);
+
+    /*! \brief Send the changes of all widgets since the last render()
+     *
+     * \return `EDIP_OK` or the first error code
+     */
+    char render();
+
+    /*! \brief Redraw all widgets with the next render()
+     *
+     * Call after the display was cleared or another screen was shown.
+     * The widgets are drawn as new: bargraphs and instruments are defined
+     * again, touch keys are not removed first.
+     */
+    void invalidate();
+
+  private:
+    EDIPTFT& _tft;
+    EDIPWidget* _first;
+    EDIPWidget* _last;
+};
+#endif
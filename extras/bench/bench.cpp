@@ -0,0 +1,196 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Wire-level benchmark: runs typical screen workloads against the display
+// simulator and reports bytes, packets, ACK round trips and the time the
+// workload takes at different baud rates. Build from the library root:
+//
+//   g++ -O2 -DARDUINO=100 -I. -Iextras/host EDIPTFT.cpp EDIPFont.cpp
+//       extras/host/*.cpp extras/bench/bench.cpp -o bench
+
+#include <stdio.h>
+#include "EDIPSimulator.h"
+
+static const long bauds[] = {9600, 115200, 230400};
+
+
+static void fullRedraw(EDIPTFT& tft) {
+  int i;
+  tft.clear();
+  tft.setDisplayColor(EA_WHITE, EA_BLACK);
+  tft.setLineColor(EA_LIGHTGREY, EA_BLACK);
+  tft.setLineThick(1, 1);
+  for (i = 0; i < 8; i++) {
+    tft.drawRectf(i * 30, 0, i * 30 + 28, 14, EA_DARKGREY);
+    tft.drawLine(0, 16 + i * 14, 239, 16 + i * 14);
+  }
+  tft.setTextColor(EA_WHITE, EA_DARKGREY);
+  tft.setTextFont(EA_FONT6X8);
+  for (i = 0; i < 8; i++) {
+    tft.drawText(i * 30 + 14, 4, 'C', "Tab");
+  }
+  tft.setTextColor(EA_WHITE, EA_BLACK);
+  for (i = 0; i < 7; i++) {
+    tft.drawText(4, 19 + i * 14, 'L', "Channel");
+    tft.drawRect(120, 18 + i * 14, 236, 28 + i * 14);
+  }
+}
+
+
+static void bargraphBurst(EDIPTFT& tft) {
+  int i;
+  for (i = 1; i <= 32; i++) {
+    tft.updateBargraph(i, (i * 7) % 100);
+  }
+}
+
+
+static void sensorStream(EDIPTFT& tft) {
+  int round, i;
+  for (round = 0; round < 20; round++) {
+    for (i = 1; i <= 32; i++) {
+      tft.updateBargraph(i, (i * 7 + round / 4) % 100);
+    }
+    for (i = 1; i <= 4; i++) {
+      tft.updateInstrument(i, (i * 20 + round) % 100);
+    }
+    tft.poll();
+  }
+}
+
+
+static void statusPage(EDIPTFT& tft) {
+  int i;
+  char line[32];
+  tft.clearRect(0, 0, 239, 127);
+  for (i = 0; i < 16; i++) {
+    tft.setTextFont(i == 0 ? EA_CHICAGO14 : EA_FONT6X8);
+    tft.setTextColor(i % 2 ? EA_WHITE : EA_YELLOW, EA_BLACK);
+    snprintf(line, sizeof(line), "Status %2d: OK, 12.5V 0.8A", i);
+    tft.drawText(2, i * 8, 'L', line);
+  }
+}
+
+
+static void barChart(EDIPTFT& tft) {
+  int i, x, h;
+  tft.clearRect(0, 0, 239, 127);
+  for (i = 0; i < 6; i++) {
+    // grid drawn in segments, one per column
+    for (x = 0; x < 240; x += 40) {
+      tft.drawLine(x, 20 * i + 7, x + 39, 20 * i + 7);
+    }
+  }
+  for (i = 0; i < 48; i++) {
+    // columns of one pixel wide bars, neighbours often of equal height
+    h = 20 + (i / 6) * 12;
+    tft.fillRect(i * 5, 127 - h, i * 5 + 4, 127);
+  }
+}
+
+
+static void touchKeypad(EDIPTFT& tft) {
+  int row, col;
+  char label[4];
+  tft.setTouchkeyColors(EA_WHITE, EA_DARKGREY, EA_WHITE,
+                        EA_WHITE, EA_BLUE, EA_WHITE);
+  tft.setTouchkeyFont(EA_GENEVA10);
+  tft.setTouchkeyLabelColors(EA_WHITE, EA_YELLOW);
+  for (row = 0; row < 4; row++) {
+    for (col = 0; col < 3; col++) {
+      snprintf(label, sizeof(label), "C%c", "123456789*0#"[row * 3 + col]);
+      tft.defineTouchKey(col * 40, row * 30, col * 40 + 38, row * 30 + 28,
+                         row * 3 + col + 1, 0, label);
+    }
+  }
+}
+
+
+static const struct {
+  const char* name;
+  void (*run)(EDIPTFT& tft);
+} workloads[] = {
+  {"full redraw", fullRedraw},
+  {"32 bargraphs", bargraphBurst},
+  {"sensor stream", sensorStream},
+  {"status page", statusPage},
+  {"bar chart", barChart},
+  {"touch keypad", touchKeypad},
+};
+
+
+static const struct {
+  const char* name;
+  void (*setup)(EDIPTFT& tft);
+} modes[] = {
+  {"default", 0},
+  {"batching", [](EDIPTFT& tft) { tft.setBatching(true); }},
+  {"cache", [](EDIPTFT& tft) { tft.setStateCache(true); }},
+  {"cache+batch", [](EDIPTFT& tft) {
+    tft.setStateCache(true);
+    tft.setBatching(true);
+  }},
+  {"coalesce", [](EDIPTFT& tft) { tft.setUpdateRate(20); }},
+  {"geometry", [](EDIPTFT& tft) { tft.setGeometryCoalescing(true); }},
+};
+
+
+int main() {
+  unsigned int w, m, b;
+
+  printf("%-14s %-12s %8s %8s %8s %8s", "workload", "mode", "bytes",
+         "packets", "acks", "cmds");
+  for (b = 0; b < sizeof(bauds) / sizeof(bauds[0]); b++) {
+    printf(" %7ld Bd", bauds[b]);
+  }
+  printf("\n");
+
+  for (w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+    for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+      for (b = 0; b < sizeof(bauds) / sizeof(bauds[0]); b++) {
+        EDIPSimulator sim;
+        EDIPTFT tft(sim);
+        tft.begin(bauds[b]);
+        if (modes[m].setup) {
+          modes[m].setup(tft);
+        }
+        hostClockReset();
+        workloads[w].run(tft);
+        tft.flushValues();
+        tft.flush();
+        tft.poll();
+
+        const EDIPSimStats& stats = sim.stats();
+        if (b == 0) {
+          printf("%-14s %-12s %8lu %8lu %8lu %8lu", workloads[w].name,
+                 modes[m].name, stats.bytesIn + stats.bytesOut,
+                 stats.packets + stats.requests, stats.acks + stats.naks,
+                 stats.commands);
+        }
+        printf(" %7.1f ms", hostClockMicros() / 1000.0);
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
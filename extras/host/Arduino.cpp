@@ -0,0 +1,58 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "Arduino.h"
+
+static unsigned long long clockMicros = 0;
+
+
+unsigned long millis() {
+  clockMicros += EDIPHOST_SPIN_US;
+  return clockMicros / 1000;
+}
+
+
+unsigned long micros() {
+  clockMicros += EDIPHOST_SPIN_US;
+  return clockMicros;
+}
+
+
+void delay(unsigned long ms) {
+  clockMicros += 1000ULL * ms;
+}
+
+
+unsigned long long hostClockMicros() {
+  return clockMicros;
+}
+
+
+void hostClockAdvance(unsigned long long us) {
+  clockMicros += us;
+}
+
+
+void hostClockReset() {
+  clockMicros = 0;
+}
@@ -0,0 +1,106 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Minimal Arduino environment for building EDIPTFT on a host (Linux) with
+// -DARDUINO=100 -Iextras/host. Time is virtual: it only advances through
+// delay(), hostClockAdvance() and a small step on every millis()/micros()
+// call, so busy-wait loops terminate and runs are reproducible.
+
+#ifndef EDIPHost_Arduino_h
+#define EDIPHost_Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// there is no SERIAL_DEV on the host, always pass a transport
+#define EDIPTFT_NO_SERIAL_DEV
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+// Arduino's min()/max() are macros, templates do not break <algorithm>
+template <class A, class B>
+inline auto min(A a, B b) -> decltype(a + b) {
+  return a < b ? a : b;
+}
+
+template <class A, class B>
+inline auto max(A a, B b) -> decltype(a + b) {
+  return a > b ? a : b;
+}
+
+template <class T, class L, class H>
+inline T constrain(T v, L low, H high) {
+  return v < low ? low : v > high ? high : v;
+}
+
+#define DEC 10
+#define HEX 16
+
+// Virtual time spent by one millis()/micros() call in a busy-wait loop
+#define EDIPHOST_SPIN_US 1
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// host additions
+unsigned long long hostClockMicros();
+void hostClockAdvance(unsigned long long us);
+void hostClockReset();
+
+/*! \brief Byte sink, like the Arduino class
+ */
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+      size_t i;
+      for (i = 0; i < len; i++) {
+        if (write(buf[i]) != 1) {
+          break;
+        }
+      }
+      return i;
+    }
+    size_t write(const char* buf, size_t len) {
+      return write((const uint8_t*)buf, len);
+    }
+};
+
+/*! \brief Byte source, like the Arduino class
+ */
+class Stream : public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
+#endif
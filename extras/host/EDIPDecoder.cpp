@@ -0,0 +1,251 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPDecoder.h"
+
+#define STATE_IDLE 0
+#define STATE_GROUP 1
+#define STATE_CODE 2
+#define STATE_PARAMS 3
+
+static const struct {
+  char group;
+  char code;
+  const char* format;
+} commandFormats[] = {
+  {'D', 'L', ""},        // deleteDisplay
+  {'D', 'I', ""},        // invert
+  {'D', 'F', "b"},       // fillDisplayColor
+  {'F', 'D', "bb"},      // setDisplayColor
+  {'Y', 'L', "b"},       // displayIllumination
+  {'Y', 'H', "b"},       // setDisplayIlluminationLevel
+  {'Y', 'S', "b"},       // soundBuzzer
+  {'Y', 'W', "bb"},      // setOutputPort
+  {'Y', 'B', "b"},       // linkBargraphLight
+  {'T', 'E', ""},        // terminalOn
+  {'T', 'A', ""},
+  {'T', 'C', "b"},       // cursorOn
+  {'T', 'P', "bb"},      // setCursor
+  {'U', 'I', "ccb"},     // loadImage
+  {'U', 'L', "ccm"},     // sendImage
+  {'U', 'H', "cccc"},    // requestHardcopy
+  {'B', 'L', "bccccbbbb"},  // defineBargraph
+  {'B', 'R', "bccccbbbb"},
+  {'B', 'O', "bccccbbbb"},
+  {'B', 'U', "bccccbbbb"},
+  {'B', 'A', "bb"},      // updateBargraph
+  {'B', 'D', "bb"},      // deleteBargraph
+  {'F', 'B', "bbbb"},    // setBargraphColor
+  {'I', 'P', "bccbbbb"}, // defineInstrument
+  {'I', 'A', "bb"},      // updateInstrument
+  {'I', 'N', "b"},       // redrawInstrument
+  {'I', 'D', "bbb"},     // deleteInstrument
+  {'F', 'G', "bb"},      // setLineColor
+  {'G', 'Z', "bb"},      // setLineThick
+  {'G', 'D', "cccc"},    // drawLine
+  {'G', 'R', "cccc"},    // drawRect
+  {'F', 'Z', "bb"},      // setTextColor
+  {'Z', 'F', "b"},       // setTextFont
+  {'Z', 'W', "b"},       // setTextAngle
+  {'Z', 'L', "ccs"},     // drawText
+  {'Z', 'C', "ccs"},
+  {'Z', 'R', "ccs"},
+  {'R', 'F', "ccccb"},   // drawRectf
+  {'R', 'L', "cccc"},    // clearRect
+  {'R', 'I', "cccc"},    // invertRect
+  {'R', 'S', "cccc"},    // fillRect
+  {'R', 'M', "ccccb"},   // fillRectp
+  {'A', 'S', "b"},       // setTouchBuzzer
+  {'A', 'B', "b"},       // makeBargraphTouch
+  {'A', 'T', "ccccbbs"}, // defineTouchKey
+  {'A', 'K', "ccccbbs"}, // defineTouchSwitch
+  {'A', 'J', "ccbbbs"},  // defineTouchSwitch with image
+  {'A', 'P', "bb"},      // setTouchSwitch
+  {'A', 'F', "b"},       // setTouchkeyFont
+  {'A', 'R', "b"},       // setTouchGroup
+  {'A', 'L', "bb"},      // removeTouchArea
+  {'A', 'M', "ccccbbbs"},  // defineTouchMenu
+  {'F', 'E', "bbbbbb"},  // setTouchkeyColors
+  {'F', 'A', "bb"},      // setTouchkeyLabelColors
+  {'M', 'N', "b"},       // callMacro
+  {'M', 'T', "b"},       // callTouchMacro
+  {'M', 'M', "b"},       // callMenuMacro
+  {'N', 'T', "b"},       // openTouchMenu, setTouchMenuAutomation
+  {'N', 'F', "b"},       // setMenuFont
+};
+
+
+EDIPDecoder::EDIPDecoder(unsigned char coordSize) {
+  _listener = 0;
+  _coordSize = coordSize;
+  _commands = 0;
+  _errors = 0;
+  reset();
+}
+
+
+void EDIPDecoder::setListener(EDIPCommandListener* listener) {
+  _listener = listener;
+}
+
+
+void EDIPDecoder::setCoordSize(unsigned char coordSize) {
+  _coordSize = coordSize;
+}
+
+
+unsigned char EDIPDecoder::coordSize() {
+  return _coordSize;
+}
+
+
+void EDIPDecoder::reset() {
+  _state = STATE_IDLE;
+  _format = 0;
+}
+
+
+boolean EDIPDecoder::busy() {
+  return _state != STATE_IDLE;
+}
+
+
+unsigned long EDIPDecoder::commands() {
+  return _commands;
+}
+
+
+unsigned long EDIPDecoder::errors() {
+  return _errors;
+}
+
+
+const char* EDIPDecoder::format(char group, char code) {
+  unsigned int i;
+  for (i = 0; i < sizeof(commandFormats) / sizeof(commandFormats[0]); i++) {
+    if (commandFormats[i].group == group && commandFormats[i].code == code) {
+      return commandFormats[i].format;
+    }
+  }
+  return 0;
+}
+
+
+void EDIPDecoder::feed(char c) {
+  unsigned char b = c;
+
+  switch (_state) {
+    case STATE_IDLE:
+      if (b == ESC) {
+        _state = STATE_GROUP;
+      }
+      else if (_listener) {
+        _listener->terminal(c);
+      }
+      return;
+
+    case STATE_GROUP:
+      _cmd.group = c;
+      _state = STATE_CODE;
+      return;
+
+    case STATE_CODE:
+      _cmd.code = c;
+      _cmd.nargs = 0;
+      _cmd.hasText = false;
+      _cmd.text[0] = 0;
+      _format = format(_cmd.group, _cmd.code);
+      if (_format == 0) {
+        _errors++;
+        reset();
+        return;
+      }
+      _state = STATE_PARAMS;
+      _coordBytes = 0;
+      _textLen = 0;
+      _dataPos = 0;
+      _dataSize = 0;
+      if (*_format == 0) {
+        emit();
+      }
+      return;
+
+    case STATE_PARAMS:
+      switch (*_format) {
+        case 'b':
+          _cmd.args[_cmd.nargs++] = b;
+          _format++;
+          break;
+        case 'c':
+          if (_coordBytes == 0) {
+            _cmd.args[_cmd.nargs] = b;
+          }
+          else {
+            _cmd.args[_cmd.nargs] |= b << 8;
+          }
+          if (++_coordBytes == _coordSize) {
+            _cmd.nargs++;
+            _coordBytes = 0;
+            _format++;
+          }
+          break;
+        case 's':
+          if (b == 0) {
+            _cmd.hasText = true;
+            _format++;
+          }
+          else if (_textLen < EDIPDECODER_MAX_TEXT - 1) {
+            _cmd.text[_textLen++] = c;
+            _cmd.text[_textLen] = 0;
+          }
+          break;
+        case 'm':
+          // BMP file, its size is stored in bytes 2..5
+          if (_dataPos >= 2 && _dataPos < 6) {
+            _dataSize |= (unsigned long)b << (8 * (_dataPos - 2));
+          }
+          if (_listener) {
+            _listener->data(_cmd, _dataPos, c);
+          }
+          _dataPos++;
+          if (_dataPos >= 6 && _dataPos >= _dataSize) {
+            _cmd.args[_cmd.nargs++] = _dataSize;
+            _format++;
+          }
+          break;
+      }
+      if (*_format == 0) {
+        emit();
+      }
+      return;
+  }
+}
+
+
+void EDIPDecoder::emit() {
+  _commands++;
+  reset();
+  if (_listener) {
+    _listener->command(_cmd);
+  }
+}
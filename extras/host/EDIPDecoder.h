@@ -0,0 +1,127 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPDecoder_h
+#define EDIPDecoder_h
+
+#include "EDIPTFT.h"
+
+#define EDIPDECODER_MAX_ARGS 12
+#define EDIPDECODER_MAX_TEXT 256
+
+/*! \brief One decoded ESC command
+ *
+ * \a group and \a code are the two letters after ESC (e.g. 'G', 'D' for
+ * drawLine()). Coordinates and byte parameters are stored in \a args in
+ * the order they appear on the wire, a string parameter in \a text.
+ */
+struct EDIPCommand {
+  char group;
+  char code;
+  int args[EDIPDECODER_MAX_ARGS];
+  unsigned char nargs;
+  char text[EDIPDECODER_MAX_TEXT];
+  boolean hasText;
+};
+
+/*! \brief Receives the output of EDIPDecoder
+ */
+class EDIPCommandListener {
+  public:
+    virtual ~EDIPCommandListener() {}
+
+    /*! \brief Called for every complete ESC command
+     */
+    virtual void command(const EDIPCommand& cmd) = 0;
+
+    /*! \brief Called for every byte of a BMP file parameter
+     *
+     * \a cmd holds the parameters before the file, \a pos is the offset
+     * of \a c in the file. command() follows after the last byte.
+     */
+    virtual void data(const EDIPCommand& /*cmd*/, unsigned long /*pos*/,
+                      char /*c*/) {}
+
+    /*! \brief Called for bytes outside of ESC commands (terminal output)
+     */
+    virtual void terminal(char /*c*/) {}
+};
+
+/*! \brief Decoder for the eDIP ESC command set
+ *
+ * Splits the data bytes of the small protocol (or the raw byte stream
+ * without small protocol) into the ESC commands sent by EDIPTFT.
+ */
+class EDIPDecoder {
+  public:
+    EDIPDecoder(unsigned char coordSize=COORD_SIZE);
+
+    void setListener(EDIPCommandListener* listener);
+    void setCoordSize(unsigned char coordSize);
+    unsigned char coordSize();
+
+    /*! \brief Decode the next byte
+     */
+    void feed(char c);
+
+    /*! \brief Drop a partially decoded command
+     */
+    void reset();
+
+    /*! \brief true while a command is only partially decoded
+     */
+    boolean busy();
+
+    /*! \brief Number of decoded commands
+     */
+    unsigned long commands();
+
+    /*! \brief Number of unknown commands
+     */
+    unsigned long errors();
+
+    /*! \brief Parameter format of a command
+     *
+     * One character per parameter: `b` byte, `c` coordinate (1 or 2
+     * bytes), `s` NUL terminated string, `m` BMP file (its size is stored
+     * in args).
+     *
+     * \return format string or 0 for unknown commands
+     */
+    static const char* format(char group, char code);
+
+  private:
+    EDIPCommandListener* _listener;
+    unsigned char _coordSize;
+    unsigned char _state;
+    const char* _format;
+    unsigned char _coordBytes;
+    unsigned short _textLen;
+    unsigned long _dataPos;
+    unsigned long _dataSize;
+    unsigned long _commands;
+    unsigned long _errors;
+    EDIPCommand _cmd;
+    void emit();
+};
+#endif
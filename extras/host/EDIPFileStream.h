@@ -0,0 +1,81 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPFileStream_h
+#define EDIPFileStream_h
+
+#include "Arduino.h"
+#include <stdio.h>
+
+/*! \brief Stream on a host file, e.g. for EDIPTFT::sendImage()
+ *
+ * Open with \a mode "wb" to write, e.g. for EDIPTrace::dump().
+ */
+class EDIPFileStream : public Stream {
+  public:
+    EDIPFileStream(const char* path, const char* mode="rb") {
+      _file = fopen(path, mode);
+      _peek = -1;
+    }
+
+    ~EDIPFileStream() {
+      if (_file) {
+        fclose(_file);
+      }
+    }
+
+    /*! \brief true if the file could be opened
+     */
+    boolean isOpen() {
+      return _file != 0;
+    }
+
+    int available() {
+      return peek() < 0 ? 0 : 1;
+    }
+
+    int read() {
+      int c = peek();
+      _peek = -1;
+      return c;
+    }
+
+    int peek() {
+      if (_peek < 0 && _file) {
+        _peek = fgetc(_file);
+        if (_peek == EOF) {
+          _peek = -1;
+        }
+      }
+      return _peek;
+    }
+
+    size_t write(uint8_t c) {
+      return _file && fputc(c, _file) != EOF ? 1 : 0;
+    }
+
+  private:
+    FILE* _file;
+    int _peek;
+};
+#endif
@@ -0,0 +1,634 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPFramebuffer.h"
+#include <stdio.h>
+
+// BMP header fields
+#define BMP_OFFSET 10
+#define BMP_WIDTH 18
+#define BMP_HEIGHT 22
+#define BMP_BPP 28
+#define BMP_COMPRESSION 30
+#define BMP_HEADER_END 34
+
+// BI_BITFIELDS, 16 bit images in RGB565
+#define BMP_BITFIELDS 3
+
+// Largest stored (uncompressed) deflate block
+#define PNG_BLOCK 65535
+
+// EA_BLACK (1) ... EA_LIGHTGREY (16), 0 is transparent
+static const unsigned long palette [] = {
+  0x000000, 0x000000, 0x0000ff, 0xff0000, 0x00ff00, 0xff00ff, 0x00ffff,
+  0xffff00, 0xffffff, 0x404040, 0xff8000, 0x8000ff, 0xff0080, 0x00ff80,
+  0x80ff00, 0x0080ff, 0x808080
+};
+
+
+EDIPFramebuffer::EDIPFramebuffer(int width, int height) {
+  _displayFg = EA_WHITE;
+  _displayBg = EA_BLACK;
+  _lineFg = EA_WHITE;
+  _lineBg = EA_BLACK;
+  _thickX = 1;
+  _thickY = 1;
+  _textFg = EA_WHITE;
+  _textBg = EA_BLACK;
+  _textFont = EA_FONT8X8;
+  _textAngle = 0;
+  _touchFont = EA_FONT8X8;
+  // outer frame, inner frame, area; normal and pressed
+  _touchColors[0] = EA_WHITE;
+  _touchColors[1] = EA_LIGHTGREY;
+  _touchColors[2] = EA_DARKGREY;
+  _touchColors[3] = EA_WHITE;
+  _touchColors[4] = EA_LIGHTGREY;
+  _touchColors[5] = EA_BLUE;
+  _touchLabel = EA_WHITE;
+  for (int i = 0; i < EDIPFRAMEBUFFER_BARGRAPHS; i++) {
+    _bargraphs[i].dir = 0;
+    _bargraphs[i].fg = EA_WHITE;
+    _bargraphs[i].bg = EA_BLACK;
+    _bargraphs[i].frame = EA_WHITE;
+  }
+  resize(width, height);
+}
+
+
+void EDIPFramebuffer::resize(int width, int height) {
+  _width = width;
+  _height = height;
+  _pixels.assign(width * height, color(_displayBg));
+  newFrame();
+}
+
+
+int EDIPFramebuffer::width() {
+  return _width;
+}
+
+
+int EDIPFramebuffer::height() {
+  return _height;
+}
+
+
+unsigned long EDIPFramebuffer::pixel(int x, int y) {
+  if (x < 0 || y < 0 || x >= _width || y >= _height) {
+    return 0;
+  }
+  return _pixels[y * _width + x];
+}
+
+
+void EDIPFramebuffer::setPixel(int x, int y, unsigned long rgb) {
+  if (x >= 0 && y >= 0 && x < _width && y < _height) {
+    _pixels[y * _width + x] = rgb;
+    if (_frameWrites[y * _width + x] < 0xffff) {
+      _frameWrites[y * _width + x]++;
+    }
+  }
+}
+
+
+unsigned long EDIPFramebuffer::color(unsigned char ea) {
+  return ea < sizeof(palette) / sizeof(palette[0]) ? palette[ea] : 0;
+}
+
+
+void EDIPFramebuffer::fill(int x1, int y1, int x2, int y2, unsigned long rgb) {
+  int x, y;
+  if (x1 > x2) {
+    x = x1;
+    x1 = x2;
+    x2 = x;
+  }
+  if (y1 > y2) {
+    y = y1;
+    y1 = y2;
+    y2 = y;
+  }
+  for (y = y1; y <= y2; y++) {
+    for (x = x1; x <= x2; x++) {
+      setPixel(x, y, rgb);
+    }
+  }
+}
+
+
+void EDIPFramebuffer::line(int x1, int y1, int x2, int y2, unsigned long rgb) {
+  // Bresenham, every point drawn with the point size
+  int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+  int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+  int err = dx + dy, e2;
+
+  for (;;) {
+    fill(x1, y1, x1 + _thickX - 1, y1 + _thickY - 1, rgb);
+    if (x1 == x2 && y1 == y2) {
+      break;
+    }
+    e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x1 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y1 += sy;
+    }
+  }
+}
+
+
+void EDIPFramebuffer::newFrame() {
+  _frameStart = _pixels;
+  _frameWrites.assign(_pixels.size(), 0);
+}
+
+
+EDIPOverdraw EDIPFramebuffer::overdraw() {
+  EDIPOverdraw o = { 0, 0, 0 };
+
+  for (size_t i = 0; i < _pixels.size(); i++) {
+    o.writes += _frameWrites[i];
+    o.pixels += _frameWrites[i] > 0;
+    o.changed += _pixels[i] != _frameStart[i];
+  }
+  return o;
+}
+
+
+// Rectangle frame, one pixel wide
+void EDIPFramebuffer::frame(int x1, int y1, int x2, int y2,
+                            unsigned long rgb) {
+  fill(x1, y1, x2, y1, rgb);
+  fill(x1, y2, x2, y2, rgb);
+  fill(x1, y1 + 1, x1, y2 - 1, rgb);
+  fill(x2, y1 + 1, x2, y2 - 1, rgb);
+}
+
+
+// Fill an area given along (u) and across (v) the text at (x, y)
+void EDIPFramebuffer::textFill(int x, int y, unsigned char angle,
+                               int u1, int v1, int u2, int v2,
+                               unsigned char ea) {
+  if (ea == 0 || u2 < u1 || v2 < v1) {
+    // transparent or empty
+    return;
+  }
+  if (angle == 1) {
+    fill(x + v1, y - u2, x + v2, y - u1, color(ea));
+  }
+  else if (angle == 2) {
+    fill(x - u2, y - v2, x - u1, y - v1, color(ea));
+  }
+  else if (angle == 3) {
+    fill(x - v2, y + u1, x - v1, y + u2, color(ea));
+  }
+  else {
+    fill(x + u1, y + v1, x + u2, y + v2, color(ea));
+  }
+}
+
+
+void EDIPFramebuffer::text(int x, int y, char justification,
+                           const char* text, unsigned char font,
+                           unsigned char angle, unsigned char fg,
+                           unsigned char bg) {
+  EDIPFont f(font);
+  int h = f.height(), v = 0, u, w;
+  char c;
+
+  for (;;) {
+    w = f.lineWidth(text);
+    u = justification == 'C' ? -(w / 2) : justification == 'R' ? 1 - w : 0;
+    while (*text && *text != '|') {
+      c = *text++;
+      if (c == '~' || c == '@') {
+        continue;
+      }
+      if (c == '\\' && *text) {
+        c = *text++;
+      }
+      w = f.charWidth(c);
+      // character cell, and a block where the glyph would be
+      textFill(x, y, angle, u, v, u + w - 1, v + h - 1, bg);
+      if (c != ' ') {
+        textFill(x, y, angle, u + 1, v + 1, u + w - 2, v + h - 2, fg);
+      }
+      u += w;
+    }
+    if (*text++ != '|') {
+      break;
+    }
+    v += h;
+  }
+}
+
+
+void EDIPFramebuffer::bargraph(unsigned char no, int value) {
+  Bargraph& b = _bargraphs[no];
+  int x1 = min(b.x1, b.x2), x2 = max(b.x1, b.x2);
+  int y1 = min(b.y1, b.y2), y2 = max(b.y1, b.y2);
+  int size, n, from;
+
+  if (!b.dir) {
+    return;
+  }
+  if (b.type == 1 || b.type == 3) {
+    frame(x1, y1, x2, y2, color(b.frame));
+    x1++;
+    y1++;
+    x2--;
+    y2--;
+  }
+  if (x2 < x1 || y2 < y1) {
+    return;
+  }
+  if (b.bg) {
+    fill(x1, y1, x2, y2, color(b.bg));
+  }
+  size = b.dir == 'L' || b.dir == 'R' ? x2 - x1 + 1 : y2 - y1 + 1;
+  if (b.ev == b.sv) {
+    n = 0;
+  }
+  else {
+    n = ((value - b.sv) * size + (b.ev - b.sv) / 2) / (b.ev - b.sv);
+  }
+  n = constrain(n, 0, size);
+  // pixels from..n-1 from the start side are drawn
+  from = b.type >= 2 ? max(n - max((int)b.mst, 1), 0) : 0;
+  if (n == from || !b.fg) {
+    return;
+  }
+  switch (b.dir) {
+    case 'R':
+      fill(x1 + from, y1, x1 + n - 1, y2, color(b.fg));
+      break;
+    case 'L':
+      fill(x2 - n + 1, y1, x2 - from, y2, color(b.fg));
+      break;
+    case 'O':
+      fill(x1, y2 - n + 1, x2, y2 - from, color(b.fg));
+      break;
+    case 'U':
+      fill(x1, y1 + from, x2, y1 + n - 1, color(b.fg));
+      break;
+  }
+}
+
+
+void EDIPFramebuffer::touchKey(const int* a, const char* label) {
+  int x1 = min(a[0], a[2]), x2 = max(a[0], a[2]);
+  int y1 = min(a[1], a[3]), y2 = max(a[1], a[3]);
+  char justification = 'C';
+  EDIPFont f(_touchFont);
+  int x;
+
+  fill(x1, y1, x2, y2, color(_touchColors[2]));
+  frame(x1 + 1, y1 + 1, x2 - 1, y2 - 1, color(_touchColors[1]));
+  frame(x1, y1, x2, y2, color(_touchColors[0]));
+  // the first character of the label is its justification
+  if (*label == 'L' || *label == 'C' || *label == 'R') {
+    justification = *label++;
+  }
+  x = justification == 'L' ? x1 + 3 : justification == 'R' ? x2 - 3
+                                                            : (x1 + x2) / 2;
+  text(x, (y1 + y2 + 1 - f.lines(label) * f.height()) / 2, justification,
+       label, _touchFont, 0, _touchLabel, 0);
+}
+
+
+void EDIPFramebuffer::data(const EDIPCommand& cmd, unsigned long pos,
+                           char c) {
+  if (cmd.group == 'U' && cmd.code == 'L') {
+    if (pos == 0) {
+      _image.clear();
+    }
+    _image.push_back(c);
+  }
+}
+
+
+static unsigned long get32(const std::vector<unsigned char>& d, size_t at) {
+  return d[at] | d[at + 1] << 8 | d[at + 2] << 16 |
+         (unsigned long)d[at + 3] << 24;
+}
+
+
+// Draw the BMP file collected by data() with its upper left corner at x, y
+void EDIPFramebuffer::image(int x, int y) {
+  unsigned long offset, compression, rowSize, at;
+  long width, height;
+  unsigned int bpp, v;
+  int row, col, py;
+
+  if (_image.size() < BMP_HEADER_END || _image[0] != 'B' ||
+      _image[1] != 'M') {
+    return;
+  }
+  offset = get32(_image, BMP_OFFSET);
+  width = (long)get32(_image, BMP_WIDTH);
+  height = (long)(int)get32(_image, BMP_HEIGHT);
+  bpp = _image[BMP_BPP] | _image[BMP_BPP + 1] << 8;
+  compression = get32(_image, BMP_COMPRESSION);
+  if ((bpp != 16 && bpp != 24 && bpp != 32) || width <= 0 || height == 0) {
+    return;
+  }
+  rowSize = (width * bpp / 8 + 3) & ~3UL;
+  for (row = 0; row < labs(height); row++) {
+    // rows are stored bottom-up unless the height is negative
+    py = height > 0 ? height - 1 - row : row;
+    for (col = 0; col < width; col++) {
+      at = offset + row * rowSize + col * (bpp / 8);
+      if (at + bpp / 8 > _image.size()) {
+        return;
+      }
+      if (bpp == 16) {
+        v = _image[at] | _image[at + 1] << 8;
+        if (compression == BMP_BITFIELDS) {
+          setPixel(x + col, y + py, (v & 0xf800) << 8 | (v & 0x07e0) << 5 |
+                                    (v & 0x001f) << 3);
+        }
+        else {
+          setPixel(x + col, y + py, (v & 0x7c00) << 9 | (v & 0x03e0) << 6 |
+                                    (v & 0x001f) << 3);
+        }
+      }
+      else {
+        setPixel(x + col, y + py, (unsigned long)_image[at + 2] << 16 |
+                                  _image[at + 1] << 8 | _image[at]);
+      }
+    }
+  }
+}
+
+
+boolean EDIPFramebuffer::savePPM(const char* path) {
+  FILE* f = fopen(path, "wb");
+  int i;
+
+  if (!f) {
+    return false;
+  }
+  fprintf(f, "P6\n%d %d\n255\n", _width, _height);
+  for (i = 0; i < _width * _height; i++) {
+    fputc(_pixels[i] >> 16, f);
+    fputc(_pixels[i] >> 8, f);
+    fputc(_pixels[i], f);
+  }
+  return fclose(f) == 0;
+}
+
+
+static unsigned long crc32(unsigned long crc, const unsigned char* data,
+                           size_t len) {
+  int k;
+
+  crc = ~crc & 0xffffffffUL;
+  while (len--) {
+    crc ^= *data++;
+    for (k = 0; k < 8; k++) {
+      crc = crc & 1 ? (crc >> 1) ^ 0xedb88320UL : crc >> 1;
+    }
+  }
+  return ~crc & 0xffffffffUL;
+}
+
+
+static void put32(std::vector<unsigned char>& out, unsigned long v) {
+  out.push_back(v >> 24);
+  out.push_back(v >> 16);
+  out.push_back(v >> 8);
+  out.push_back(v);
+}
+
+
+// PNG chunk: length, type, data, CRC of type and data
+static void chunk(FILE* f, const char* type,
+                  const std::vector<unsigned char>& data) {
+  std::vector<unsigned char> head;
+
+  put32(head, data.size());
+  head.insert(head.end(), type, type + 4);
+  fwrite(&head[0], 1, head.size(), f);
+  if (!data.empty()) {
+    fwrite(&data[0], 1, data.size(), f);
+  }
+  head.clear();
+  put32(head, crc32(crc32(0, (const unsigned char*)type, 4),
+                    data.empty() ? 0 : &data[0], data.size()));
+  fwrite(&head[0], 1, 4, f);
+}
+
+
+boolean EDIPFramebuffer::savePNG(const char* path) {
+  static const unsigned char signature[] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+  };
+  std::vector<unsigned char> raw, data;
+  unsigned long a = 1, b = 0;
+  size_t pos, len;
+  int x, y;
+  FILE* f = fopen(path, "wb");
+
+  if (!f) {
+    return false;
+  }
+  fwrite(signature, 1, sizeof(signature), f);
+
+  // 8 bit RGB, no interlace
+  put32(data, _width);
+  put32(data, _height);
+  data.push_back(8);
+  data.push_back(2);
+  data.push_back(0);
+  data.push_back(0);
+  data.push_back(0);
+  chunk(f, "IHDR", data);
+
+  // every row starts with filter type 0
+  for (y = 0; y < _height; y++) {
+    raw.push_back(0);
+    for (x = 0; x < _width; x++) {
+      raw.push_back(_pixels[y * _width + x] >> 16);
+      raw.push_back(_pixels[y * _width + x] >> 8);
+      raw.push_back(_pixels[y * _width + x]);
+    }
+  }
+  for (pos = 0; pos < raw.size(); pos++) {
+    a = (a + raw[pos]) % 65521;
+    b = (b + a) % 65521;
+  }
+
+  // zlib stream of stored deflate blocks
+  data.clear();
+  data.push_back(0x78);
+  data.push_back(0x01);
+  for (pos = 0; pos == 0 || pos < raw.size(); pos += len) {
+    len = min(raw.size() - pos, (size_t)PNG_BLOCK);
+    data.push_back(pos + len == raw.size());
+    data.push_back(len);
+    data.push_back(len >> 8);
+    data.push_back(~len);
+    data.push_back(~len >> 8);
+    data.insert(data.end(), raw.begin() + pos, raw.begin() + pos + len);
+  }
+  put32(data, b << 16 | a);
+  chunk(f, "IDAT", data);
+
+  data.clear();
+  chunk(f, "IEND", data);
+  return fclose(f) == 0;
+}
+
+
+void EDIPFramebuffer::command(const EDIPCommand& cmd) {
+  const int* a = cmd.args;
+
+  switch ((cmd.group << 8) | cmd.code) {
+    case ('D' << 8) | 'L':
+      fill(0, 0, _width - 1, _height - 1, color(_displayBg));
+      break;
+    case ('D' << 8) | 'F':
+      fill(0, 0, _width - 1, _height - 1, color(a[0]));
+      break;
+    case ('D' << 8) | 'I':
+      for (int i = 0; i < _width * _height; i++) {
+        setPixel(i % _width, i / _width, _pixels[i] ^ 0xffffff);
+      }
+      break;
+    case ('F' << 8) | 'D':
+      _displayFg = a[0];
+      _displayBg = a[1];
+      break;
+    case ('F' << 8) | 'G':
+      _lineFg = a[0];
+      _lineBg = a[1];
+      break;
+    case ('G' << 8) | 'Z':
+      _thickX = a[0] ? a[0] : 1;
+      _thickY = a[1] ? a[1] : 1;
+      break;
+    case ('G' << 8) | 'D':
+      line(a[0], a[1], a[2], a[3], color(_lineFg));
+      break;
+    case ('G' << 8) | 'R':
+      line(a[0], a[1], a[2], a[1], color(_lineFg));
+      line(a[2], a[1], a[2], a[3], color(_lineFg));
+      line(a[2], a[3], a[0], a[3], color(_lineFg));
+      line(a[0], a[3], a[0], a[1], color(_lineFg));
+      break;
+    case ('R' << 8) | 'S':
+      fill(a[0], a[1], a[2], a[3], color(_lineFg));
+      break;
+    case ('R' << 8) | 'L':
+      fill(a[0], a[1], a[2], a[3], color(_displayBg));
+      break;
+    case ('R' << 8) | 'F':
+      fill(a[0], a[1], a[2], a[3], color(a[4]));
+      break;
+    case ('R' << 8) | 'I':
+      for (int y = min(a[1], a[3]); y <= max(a[1], a[3]); y++) {
+        for (int x = min(a[0], a[2]); x <= max(a[0], a[2]); x++) {
+          setPixel(x, y, pixel(x, y) ^ 0xffffff);
+        }
+      }
+      break;
+    case ('F' << 8) | 'Z':
+      _textFg = a[0];
+      _textBg = a[1];
+      break;
+    case ('Z' << 8) | 'F':
+      _textFont = a[0];
+      break;
+    case ('Z' << 8) | 'W':
+      _textAngle = a[0];
+      break;
+    case ('Z' << 8) | 'L':
+    case ('Z' << 8) | 'C':
+    case ('Z' << 8) | 'R':
+      text(a[0], a[1], cmd.code, cmd.text, _textFont, _textAngle, _textFg,
+           _textBg);
+      break;
+    case ('B' << 8) | 'L':
+    case ('B' << 8) | 'R':
+    case ('B' << 8) | 'O':
+    case ('B' << 8) | 'U':
+      if (a[0] > 0 && a[0] < EDIPFRAMEBUFFER_BARGRAPHS) {
+        Bargraph& b = _bargraphs[a[0]];
+        b.dir = cmd.code;
+        b.x1 = a[1];
+        b.y1 = a[2];
+        b.x2 = a[3];
+        b.y2 = a[4];
+        b.sv = a[5];
+        b.ev = a[6];
+        b.type = a[7];
+        b.mst = a[8];
+        bargraph(a[0], b.sv);
+      }
+      break;
+    case ('B' << 8) | 'A':
+      if (a[0] > 0 && a[0] < EDIPFRAMEBUFFER_BARGRAPHS) {
+        bargraph(a[0], a[1]);
+      }
+      break;
+    case ('B' << 8) | 'D':
+      if (a[0] > 0 && a[0] < EDIPFRAMEBUFFER_BARGRAPHS &&
+          _bargraphs[a[0]].dir) {
+        Bargraph& b = _bargraphs[a[0]];
+        if (a[1]) {
+          fill(b.x1, b.y1, b.x2, b.y2, color(_displayBg));
+        }
+        b.dir = 0;
+      }
+      break;
+    case ('F' << 8) | 'B':
+      if (a[0] > 0 && a[0] < EDIPFRAMEBUFFER_BARGRAPHS) {
+        _bargraphs[a[0]].fg = a[1];
+        _bargraphs[a[0]].bg = a[2];
+        _bargraphs[a[0]].frame = a[3];
+      }
+      break;
+    case ('A' << 8) | 'F':
+      _touchFont = a[0];
+      break;
+    case ('F' << 8) | 'E':
+      for (int i = 0; i < 6; i++) {
+        _touchColors[i] = a[i];
+      }
+      break;
+    case ('F' << 8) | 'A':
+      _touchLabel = a[0];
+      break;
+    case ('A' << 8) | 'T':
+    case ('A' << 8) | 'K':
+      touchKey(a, cmd.text);
+      break;
+    case ('U' << 8) | 'L':
+      image(a[0], a[1]);
+      break;
+  }
+}
@@ -0,0 +1,134 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPFramebuffer_h
+#define EDIPFramebuffer_h
+
+#include <vector>
+#include "EDIPDecoder.h"
+#include "EDIPFont.h"
+
+// Bargraph numbers 1..32
+#define EDIPFRAMEBUFFER_BARGRAPHS 33
+
+/*! \brief Pixel writes of one frame, see EDIPFramebuffer::newFrame()
+ */
+struct EDIPOverdraw {
+  unsigned long writes;   // pixels drawn, counting every time
+  unsigned long pixels;   // different pixels drawn
+  unsigned long changed;  // pixels that have another color than before
+};
+
+/*! \brief Screen contents of a simulated display
+ *
+ * Draws the decoded ESC commands into an RGB framebuffer (one 0xRRGGBB
+ * value per pixel): display, line, text, bargraph and touch key colors,
+ * clearing, lines, rectangles and rectangle areas, text, bargraphs,
+ * touch key outlines and uploaded BMP images. Other commands leave the
+ * pixels alone. EDIPSimulator keeps one to answer hardcopy requests.
+ *
+ * There are no glyph shapes: every character is drawn as its cell in
+ * the text background color with a block in the text color, sized with
+ * the metrics of EDIPFont. This is enough to check where text goes and
+ * what it covers.
+ *
+ * To find needless repainting, call newFrame() before a screen update
+ * and overdraw() after it.
+ */
+class EDIPFramebuffer : public EDIPCommandListener {
+  public:
+    EDIPFramebuffer(int width=320, int height=240);
+
+    void command(const EDIPCommand& cmd);
+    void data(const EDIPCommand& cmd, unsigned long pos, char c);
+
+    /*! \brief Resize and clear to the display background
+     */
+    void resize(int width, int height);
+
+    int width();
+    int height();
+
+    /*! \brief Color of a pixel, 0 outside of the screen
+     */
+    unsigned long pixel(int x, int y);
+    void setPixel(int x, int y, unsigned long rgb);
+
+    /*! \brief RGB value of an EA color number (EA_BLACK ... EA_LIGHTGREY)
+     */
+    static unsigned long color(unsigned char ea);
+
+    /*! \brief Start counting the pixel writes of a new frame
+     */
+    void newFrame();
+
+    /*! \brief Pixel writes since newFrame()
+     */
+    EDIPOverdraw overdraw();
+
+    /*! \brief Write the screen as binary PPM (P6) file
+     */
+    boolean savePPM(const char* path);
+
+    /*! \brief Write the screen as PNG file
+     *
+     * The image data is stored without compression, so no zlib is
+     * needed; the files are about as large as PPM files.
+     */
+    boolean savePNG(const char* path);
+
+  protected:
+    int _width;
+    int _height;
+    std::vector<unsigned long> _pixels;
+    unsigned char _displayFg, _displayBg;
+    unsigned char _lineFg, _lineBg;
+    unsigned char _thickX, _thickY;
+    unsigned char _textFg, _textBg;
+    unsigned char _textFont;
+    unsigned char _textAngle;
+    unsigned char _touchFont;
+    unsigned char _touchColors[6];
+    unsigned char _touchLabel;
+    struct Bargraph {
+      char dir;
+      int x1, y1, x2, y2;
+      unsigned char sv, ev, type, mst;
+      unsigned char fg, bg, frame;
+    } _bargraphs[EDIPFRAMEBUFFER_BARGRAPHS];
+    std::vector<unsigned char> _image;
+    std::vector<unsigned long> _frameStart;
+    std::vector<unsigned short> _frameWrites;
+    void fill(int x1, int y1, int x2, int y2, unsigned long rgb);
+    void line(int x1, int y1, int x2, int y2, unsigned long rgb);
+    void frame(int x1, int y1, int x2, int y2, unsigned long rgb);
+    void text(int x, int y, char justification, const char* text,
+              unsigned char font, unsigned char angle,
+              unsigned char fg, unsigned char bg);
+    void textFill(int x, int y, unsigned char angle,
+                  int u1, int v1, int u2, int v2, unsigned char ea);
+    void bargraph(unsigned char no, int value);
+    void touchKey(const int* a, const char* label);
+    void image(int x, int y);
+};
+#endif
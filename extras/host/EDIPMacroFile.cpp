@@ -0,0 +1,242 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPMacroFile.h"
+#include "EDIPDecoder.h"
+#include <stdio.h>
+
+static const char magic [] = "EDIPMACR";
+#define MAGIC_SIZE 8
+#define HEADER_SIZE 12
+
+
+EDIPMacroFile::EDIPMacroFile(unsigned char coordSize) {
+  _coordSize = coordSize;
+}
+
+
+boolean EDIPMacroFile::add(char kind, unsigned char number, const char* data,
+                           size_t len) {
+  size_t i;
+  EDIPMacro macro;
+
+  if ((kind != EDIPMACRO_NORMAL && kind != EDIPMACRO_TOUCH &&
+       kind != EDIPMACRO_MENU) || len > 0xffff) {
+    return false;
+  }
+  macro.kind = kind;
+  macro.number = number;
+  macro.data.assign(data, data + len);
+  for (i = 0; i < _macros.size(); i++) {
+    if (_macros[i].kind == kind && _macros[i].number == number) {
+      _macros[i] = macro;
+      return true;
+    }
+  }
+  _macros.push_back(macro);
+  return true;
+}
+
+
+size_t EDIPMacroFile::count() {
+  return _macros.size();
+}
+
+
+const EDIPMacro& EDIPMacroFile::macro(size_t i) {
+  return _macros[i];
+}
+
+
+unsigned char EDIPMacroFile::coordSize() {
+  return _coordSize;
+}
+
+
+boolean EDIPMacroFile::save(const char* path) {
+  FILE* f = fopen(path, "wb");
+  size_t i, j;
+  unsigned char bcc;
+
+  if (!f) {
+    return false;
+  }
+  fwrite(magic, 1, MAGIC_SIZE, f);
+  fputc(EDIPMACRO_VERSION, f);
+  fputc(_coordSize, f);
+  fputc(lowByte(_macros.size()), f);
+  fputc(highByte(_macros.size()), f);
+  for (i = 0; i < _macros.size(); i++) {
+    const EDIPMacro& macro = _macros[i];
+    fputc(macro.kind, f);
+    fputc(macro.number, f);
+    fputc(lowByte(macro.data.size()), f);
+    fputc(highByte(macro.data.size()), f);
+    bcc = 0;
+    for (j = 0; j < macro.data.size(); j++) {
+      bcc += macro.data[j];
+    }
+    if (!macro.data.empty()) {
+      fwrite(&macro.data[0], 1, macro.data.size(), f);
+    }
+    fputc(bcc, f);
+  }
+  return fclose(f) == 0;
+}
+
+
+// Writes decoded commands as macro source lines
+class SourceWriter : public EDIPCommandListener {
+  public:
+    SourceWriter(FILE* file) : _file(file), _terminal(false) {}
+
+    void command(const EDIPCommand& cmd) {
+      const char* format = EDIPDecoder::format(cmd.group, cmd.code);
+      unsigned char i;
+      char quote;
+
+      endTerminal();
+      if (strchr(format, 'm')) {
+        fprintf(_file, "; ESC %c %c with an inline BMP file has no source "
+                "form, load the image with #UI\n", cmd.group, cmd.code);
+        return;
+      }
+      fprintf(_file, "#%c%c", cmd.group, cmd.code);
+      for (i = 0; i < cmd.nargs; i++) {
+        fprintf(_file, "%s%d", i ? "," : " ", cmd.args[i]);
+      }
+      if (cmd.hasText) {
+        quote = strchr(cmd.text, '"') ? '\'' : '"';
+        fprintf(_file, "%s%c%s%c", cmd.nargs ? "," : " ", quote, cmd.text,
+                quote);
+      }
+      fprintf(_file, "\n");
+    }
+
+    void terminal(char c) {
+      if (!_terminal) {
+        fprintf(_file, "; terminal output, not part of the macro:");
+        _terminal = true;
+      }
+      fprintf(_file, " %02x", (unsigned char)c);
+    }
+
+    void endTerminal() {
+      if (_terminal) {
+        fprintf(_file, "\n");
+        _terminal = false;
+      }
+    }
+
+  private:
+    FILE* _file;
+    boolean _terminal;
+};
+
+
+boolean EDIPMacroFile::saveSource(const char* path) {
+  FILE* f = fopen(path, "w");
+  SourceWriter writer(f);
+  EDIPDecoder decoder(_coordSize);
+  unsigned long errors;
+  size_t i, j;
+
+  if (!f) {
+    return false;
+  }
+  fprintf(f,
+          "; Macros recorded with EDIPTFT::beginRecording(), written by "
+          "edipmacro.\n"
+          "; Include this file in the macro project of your display (display\n"
+          "; type and port lines) and compile and upload it with the macro\n"
+          "; compiler of the display vendor.\n");
+  decoder.setListener(&writer);
+  for (i = 0; i < _macros.size(); i++) {
+    const EDIPMacro& macro = _macros[i];
+    fprintf(f, "\n%s: %d\n",
+            macro.kind == EDIPMACRO_TOUCH ? "TouchMacro" :
+            macro.kind == EDIPMACRO_MENU ? "MenuMacro" : "Macro",
+            macro.number);
+    decoder.reset();
+    for (j = 0; j < macro.data.size(); j++) {
+      errors = decoder.errors();
+      decoder.feed(macro.data[j]);
+      if (decoder.errors() != errors) {
+        writer.endTerminal();
+        fprintf(f, "; unknown command, its parameters follow as terminal "
+                "output\n");
+      }
+    }
+    writer.endTerminal();
+    if (decoder.busy()) {
+      fprintf(f, "; incomplete command at the end of the recording\n");
+    }
+  }
+  return fclose(f) == 0;
+}
+
+
+boolean EDIPMacroFile::load(const char* path) {
+  FILE* f = fopen(path, "rb");
+  unsigned char header[HEADER_SIZE];
+  unsigned char entry[4];
+  unsigned int n, len, i;
+  unsigned char bcc;
+  int c;
+  EDIPMacro macro;
+  boolean ok = true;
+
+  if (!f) {
+    return false;
+  }
+  _macros.clear();
+  if (fread(header, 1, HEADER_SIZE, f) != HEADER_SIZE ||
+      memcmp(header, magic, MAGIC_SIZE) != 0 ||
+      header[MAGIC_SIZE] != EDIPMACRO_VERSION) {
+    fclose(f);
+    return false;
+  }
+  _coordSize = header[9];
+  n = header[10] | (header[11] << 8);
+  while (ok && n-- > 0) {
+    ok = fread(entry, 1, sizeof(entry), f) == sizeof(entry);
+    len = entry[2] | (entry[3] << 8);
+    macro.kind = entry[0];
+    macro.number = entry[1];
+    macro.data.resize(len);
+    if (ok && len > 0) {
+      ok = fread(&macro.data[0], 1, len, f) == len;
+    }
+    bcc = 0;
+    for (i = 0; i < len; i++) {
+      bcc += macro.data[i];
+    }
+    c = fgetc(f);
+    ok = ok && c == bcc;
+    if (ok) {
+      _macros.push_back(macro);
+    }
+  }
+  fclose(f);
+  return ok;
+}
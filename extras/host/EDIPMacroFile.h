@@ -0,0 +1,91 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPMacroFile_h
+#define EDIPMacroFile_h
+
+#include "EDIPTFT.h"
+#include <vector>
+
+// Macro kinds, the code of the command that calls them (ESC M code nr)
+#define EDIPMACRO_NORMAL 'N'
+#define EDIPMACRO_TOUCH 'T'
+#define EDIPMACRO_MENU 'M'
+
+#define EDIPMACRO_VERSION 1
+
+/*! \brief One macro: kind, number and recorded ESC commands
+ */
+struct EDIPMacro {
+  char kind;
+  unsigned char number;
+  std::vector<char> data;
+};
+
+/*! \brief Container for macros recorded with EDIPTFT::beginRecording()
+ *
+ * Collects recordings and writes them as macro source for the macro
+ * compiler of the display vendor, which compiles and uploads them
+ * (saveSource()). save() and load() keep the raw recordings in an
+ * intermediate file that only edipmacro reads; its layout is described
+ * in extras/macro/README.md.
+ */
+class EDIPMacroFile {
+  public:
+    EDIPMacroFile(unsigned char coordSize=COORD_SIZE);
+
+    /*! \brief Add a recording
+     *
+     * Replaces a macro of the same kind and number.
+     *
+     * \return false if \a kind is unknown or \a len exceeds 65535 bytes
+     */
+    boolean add(char kind, unsigned char number, const char* data, size_t len);
+
+    size_t count();
+    const EDIPMacro& macro(size_t i);
+    unsigned char coordSize();
+
+    /*! \brief Write the recordings to an intermediate macro file
+     */
+    boolean save(const char* path);
+
+    /*! \brief Write the macros as macro source (`#XY` commands)
+     *
+     * Commands that have no source form (inline BMP files, terminal
+     * output) are written as comments.
+     */
+    boolean saveSource(const char* path);
+
+    /*! \brief Read a macro file
+     *
+     * \return false if the file cannot be read, has a wrong header or a
+     *         wrong checksum
+     */
+    boolean load(const char* path);
+
+  private:
+    unsigned char _coordSize;
+    std::vector<EDIPMacro> _macros;
+};
+#endif
@@ -0,0 +1,490 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#include "EDIPSimulator.h"
+
+#define STATE_IDLE 0
+#define STATE_LEN 1
+#define STATE_DATA 2
+#define STATE_BCC 3
+
+// The display drops a partial packet after this gap between two bytes
+// (1/100 s, changed with DC2 D)
+#define PACKET_TIMEOUT 20
+
+// Baud rates in the order of their codes for DC2 B (code = index + 1)
+static const long baudRates [] = {
+  1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400
+};
+#define BAUD_RATES (sizeof(baudRates) / sizeof(baudRates[0]))
+
+// Size of the receive buffer reported to datainBuffer()
+#define RECEIVE_BUFFER_SIZE 255
+
+
+EDIPSimulator::EDIPSimulator(unsigned char coordSize) :
+    _decoder(coordSize),
+    _screen(coordSize == 1 ? 240 : 320, coordSize == 1 ? 128 : 240) {
+  _listener = 0;
+  _decoder.setListener(this);
+  _baud = 115200;
+  _ackDelay = 100;
+  _nakEvery = 0;
+  _frames = 0;
+  _corruptEvery = 0;
+  _responses = 0;
+  _lastResponseLen = 0;
+  _sendPacketSize = 64;
+  _maxPacketSize = 255;
+  _timeout = PACKET_TIMEOUT;
+  _displayBaud = 0;
+  _maxBaud = 0;
+  _lineBytes = 0;
+  _address = 0;
+  _selected = false;
+  _connected = true;
+  _smallprotocol = true;
+  _txLineFree = 0;
+  _rxLineFree = 0;
+  _lastByte = 0;
+  _state = STATE_IDLE;
+  resetStats();
+}
+
+
+void EDIPSimulator::begin(long baud) {
+  _baud = baud;
+  if (_displayBaud == 0) {
+    _displayBaud = baud;
+  }
+}
+
+
+size_t EDIPSimulator::write(const char* buf, size_t len) {
+  size_t i;
+  unsigned long long now = hostClockMicros();
+  for (i = 0; i < len; i++) {
+    // bytes are queued in the UART and arrive one after the other
+    if (_txLineFree < now) {
+      _txLineFree = now;
+    }
+    _txLineFree += byteMicros();
+    _stats.wireMicros += byteMicros();
+    _stats.bytesIn++;
+    receive(buf[i], _txLineFree);
+  }
+  return len;
+}
+
+
+int EDIPSimulator::available() {
+  unsigned long long now = hostClockMicros();
+  int n = 0;
+  while (n < (int)_rxReady.size() && _rxReady[n] <= now) {
+    n++;
+  }
+  return n;
+}
+
+
+int EDIPSimulator::read() {
+  if (available() == 0) {
+    return -1;
+  }
+  unsigned char c = _rx.front();
+  _rx.pop_front();
+  _rxReady.pop_front();
+  return c;
+}
+
+
+void EDIPSimulator::setListener(EDIPCommandListener* listener) {
+  _listener = listener;
+}
+
+
+void EDIPSimulator::setSmallProtocol(boolean on) {
+  _smallprotocol = on;
+}
+
+
+void EDIPSimulator::setAckDelay(unsigned long us) {
+  _ackDelay = us;
+}
+
+
+void EDIPSimulator::setAddress(unsigned char address) {
+  _address = address;
+  _selected = false;
+}
+
+
+void EDIPSimulator::setConnected(boolean on) {
+  _connected = on;
+}
+
+
+void EDIPSimulator::setNakEvery(unsigned int n) {
+  _nakEvery = n;
+}
+
+
+void EDIPSimulator::setCorruptEvery(unsigned int n) {
+  _corruptEvery = n;
+}
+
+
+void EDIPSimulator::queueSendBuffer(const char* data, size_t len) {
+  _sendBuffer.insert(_sendBuffer.end(), data, data + len);
+}
+
+
+void EDIPSimulator::setSendPacketSize(unsigned char size) {
+  _sendPacketSize = size;
+}
+
+
+void EDIPSimulator::setMaxPacketSize(unsigned char size) {
+  _maxPacketSize = size;
+}
+
+
+void EDIPSimulator::setDisplayBaud(long baud) {
+  _displayBaud = baud;
+}
+
+
+void EDIPSimulator::setMaxBaud(long baud) {
+  _maxBaud = baud;
+}
+
+
+unsigned long EDIPSimulator::displayBaud() {
+  return _displayBaud ? _displayBaud : _baud;
+}
+
+
+unsigned long EDIPSimulator::baud() {
+  return _baud;
+}
+
+
+EDIPFramebuffer& EDIPSimulator::screen() {
+  return _screen;
+}
+
+
+void EDIPSimulator::command(const EDIPCommand& cmd) {
+  _screen.command(cmd);
+  if (cmd.group == 'U' && cmd.code == 'H') {
+    hardcopy(cmd.args[0], cmd.args[1], cmd.args[2], cmd.args[3]);
+  }
+  if (_listener) {
+    _listener->command(cmd);
+  }
+}
+
+
+void EDIPSimulator::data(const EDIPCommand& cmd, unsigned long pos, char c) {
+  _screen.data(cmd, pos, c);
+  if (_listener) {
+    _listener->data(cmd, pos, c);
+  }
+}
+
+
+void EDIPSimulator::terminal(char c) {
+  if (_listener) {
+    _listener->terminal(c);
+  }
+}
+
+
+static void put32(std::vector<unsigned char>& buf, size_t offset,
+                  unsigned long value) {
+  size_t i;
+  for (i = 0; i < 4; i++) {
+    buf[offset + i] = (value >> (8 * i)) & 0xff;
+  }
+}
+
+
+void EDIPSimulator::hardcopy(int x1, int y1, int x2, int y2) {
+  // 24 bit BMP, bottom-up, in send buffer records ESC U len data
+  int width = abs(x2 - x1) + 1, height = abs(y2 - y1) + 1;
+  int rowSize = (width * 3 + 3) & ~3;
+  unsigned long size = 54 + (unsigned long)rowSize * height;
+  std::vector<unsigned char> bmp(size, 0);
+  unsigned long rgb;
+  size_t i, n;
+  int x, y;
+
+  bmp[0] = 'B';
+  bmp[1] = 'M';
+  put32(bmp, 2, size);
+  put32(bmp, 10, 54);
+  put32(bmp, 14, 40);
+  put32(bmp, 18, width);
+  put32(bmp, 22, height);
+  bmp[26] = 1;
+  bmp[28] = 24;
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      rgb = _screen.pixel(min(x1, x2) + x, max(y1, y2) - y);
+      n = 54 + (size_t)y * rowSize + x * 3;
+      bmp[n] = rgb & 0xff;
+      bmp[n + 1] = (rgb >> 8) & 0xff;
+      bmp[n + 2] = (rgb >> 16) & 0xff;
+    }
+  }
+  for (i = 0; i < size; i += n) {
+    n = size - i < 255 ? size - i : 255;
+    _sendBuffer.push_back(ESC);
+    _sendBuffer.push_back('U');
+    _sendBuffer.push_back(n);
+    _sendBuffer.insert(_sendBuffer.end(), bmp.begin() + i, bmp.begin() + i + n);
+  }
+}
+
+
+EDIPDecoder& EDIPSimulator::decoder() {
+  return _decoder;
+}
+
+
+const EDIPSimStats& EDIPSimulator::stats() {
+  _stats.commands = _decoder.commands();
+  _stats.errors = _decoder.errors();
+  return _stats;
+}
+
+
+void EDIPSimulator::resetStats() {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+
+unsigned long EDIPSimulator::byteMicros() {
+  // start bit, 8 data bits, stop bit
+  return 10000000UL / _baud;
+}
+
+
+boolean EDIPSimulator::lineWorks() {
+  return _displayBaud == 0 || _displayBaud == _baud;
+}
+
+
+char EDIPSimulator::lineNoise(char c) {
+  if (_maxBaud != 0 && _baud > _maxBaud && ++_lineBytes % 16 == 0) {
+    return c ^ 0x55;
+  }
+  return c;
+}
+
+
+void EDIPSimulator::receive(unsigned char c, unsigned long long at) {
+  if (!_connected || !lineWorks()) {
+    return;
+  }
+  c = lineNoise(c);
+  if (!_smallprotocol) {
+    _decoder.feed(c);
+    return;
+  }
+  if (_state != STATE_IDLE && at - _lastByte > _timeout * 10000ULL) {
+    _state = STATE_IDLE;
+  }
+  _lastByte = at;
+
+  switch (_state) {
+    case STATE_IDLE:
+      if (c == DC1 || c == DC2) {
+        _frame = c;
+        _bcc = c;
+        _state = STATE_LEN;
+      }
+      return;
+
+    case STATE_LEN:
+      _len = c;
+      _bcc += c;
+      _pos = 0;
+      _state = _len ? STATE_DATA : STATE_BCC;
+      return;
+
+    case STATE_DATA:
+      _data[_pos++] = c;
+      _bcc += c;
+      if (_pos == _len) {
+        _state = STATE_BCC;
+      }
+      return;
+
+    case STATE_BCC:
+      _state = STATE_IDLE;
+      if (_frame == DC1 && _address != 0 && !_selected) {
+        // not addressed, the display stays silent
+        return;
+      }
+      _frames++;
+      if (c != _bcc || (_nakEvery && _frames % _nakEvery == 0) ||
+          (_frame == DC1 && _len > _maxPacketSize)) {
+        _stats.naks++;
+        char nak = NAK;
+        reply(&nak, 1, at);
+        return;
+      }
+      if (_frame == DC1) {
+        packet(at);
+      }
+      else {
+        request(at);
+      }
+      return;
+  }
+}
+
+
+void EDIPSimulator::packet(unsigned long long at) {
+  unsigned char i;
+  char ack = ACK;
+
+  _stats.packets++;
+  _stats.acks++;
+  reply(&ack, 1, at);
+  for (i = 0; i < _len; i++) {
+    _decoder.feed(_data[i]);
+  }
+}
+
+
+void EDIPSimulator::request(unsigned long long at) {
+  char ack = ACK;
+  char response[256];
+  unsigned char n, i;
+
+  if (_len >= 2 && _data[0] == 'A' && (_data[1] == 'S' || _data[1] == 'D')) {
+    // select/deselect by address: only the addressed display answers
+    unsigned char address = _len > 2 ? _data[2] : 0;
+    if (address != _address && address != 0xff) {
+      if (_data[1] == 'S') {
+        _selected = false;
+      }
+      return;
+    }
+    _selected = _data[1] == 'S';
+  }
+  else if (_address != 0 && !_selected) {
+    return;
+  }
+
+  _stats.requests++;
+  _stats.acks++;
+  reply(&ack, 1, at);
+  if (_len < 1) {
+    return;
+  }
+  switch (_data[0]) {
+    case 'I':
+      // bytes in send buffer, free bytes in receive buffer
+      response[0] = _sendBuffer.size() > 255 ? 255 : _sendBuffer.size();
+      response[1] = RECEIVE_BUFFER_SIZE;
+      replyFrame(DC2, response, 2, at);
+      break;
+    case 'S':
+      n = _sendBuffer.size() > _sendPacketSize ? _sendPacketSize
+                                                : _sendBuffer.size();
+      for (i = 0; i < n; i++) {
+        response[i] = _sendBuffer.front();
+        _sendBuffer.pop_front();
+      }
+      replyFrame(DC1, response, n, at);
+      break;
+    case 'P':
+      // max. packet size, send packet size, timeout
+      response[0] = _maxPacketSize;
+      response[1] = _sendPacketSize;
+      response[2] = _timeout;
+      replyFrame(DC2, response, 3, at);
+      break;
+    case 'D':
+      if (_len >= 3) {
+        _sendPacketSize = _data[1];
+        _timeout = _data[2];
+      }
+      break;
+    case 'B':
+      // the new rate applies after the ACK
+      if (_len >= 2 && (unsigned char)(_data[1] - 1) < BAUD_RATES) {
+        _displayBaud = baudRates[_data[1] - 1];
+      }
+      break;
+    case 'R':
+      // repeat the last response
+      if (_lastResponseLen) {
+        reply(_lastResponse, _lastResponseLen, at);
+      }
+      break;
+  }
+}
+
+
+void EDIPSimulator::replyFrame(char type, const char* data, unsigned char len,
+                               unsigned long long at) {
+  char frame[259];
+  unsigned char i, bcc;
+
+  frame[0] = type;
+  frame[1] = len;
+  bcc = type + len;
+  for (i = 0; i < len; i++) {
+    frame[2 + i] = data[i];
+    bcc += data[i];
+  }
+  frame[2 + len] = bcc;
+  memcpy(_lastResponse, frame, len + 3);
+  _lastResponseLen = len + 3;
+  if (_corruptEvery && ++_responses % _corruptEvery == 0) {
+    frame[2 + len] = ~bcc;
+  }
+  reply(frame, len + 3, at);
+}
+
+
+void EDIPSimulator::reply(const char* data, size_t len,
+                          unsigned long long at) {
+  size_t i;
+  if (!lineWorks()) {
+    return;
+  }
+  if (_rxLineFree < at + _ackDelay) {
+    _rxLineFree = at + _ackDelay;
+  }
+  for (i = 0; i < len; i++) {
+    _rxLineFree += byteMicros();
+    _rx.push_back(lineNoise(data[i]));
+    _rxReady.push_back(_rxLineFree);
+    _stats.bytesOut++;
+  }
+}
@@ -0,0 +1,198 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+#ifndef EDIPSimulator_h
+#define EDIPSimulator_h
+
+#include <deque>
+#include "EDIPDecoder.h"
+#include "EDIPFramebuffer.h"
+
+/*! \brief Traffic counters of EDIPSimulator
+ */
+struct EDIPSimStats {
+  unsigned long bytesIn;      // bytes received from the library
+  unsigned long bytesOut;     // bytes sent to the library (ACK, responses)
+  unsigned long packets;      // DC1 packets with correct checksum
+  unsigned long requests;     // DC2 packets with correct checksum
+  unsigned long acks;
+  unsigned long naks;
+  unsigned long commands;     // decoded ESC commands
+  unsigned long errors;       // unknown ESC commands
+  unsigned long long wireMicros;  // time the line from the library was busy
+};
+
+/*! \brief Host-side stand-in for an eDIPTFT display
+ *
+ * Use it as the transport of an EDIPTFT object. It parses the DC1/DC2
+ * small protocol framing, checks the checksum and answers ACK/NAK,
+ * decodes the ESC commands (see EDIPDecoder) and answers the buffer
+ * requests of EDIPTFT::datainBuffer() and EDIPTFT::readBuffer().
+ * The commands are drawn into a framebuffer (see screen()), hardcopy
+ * requests are answered from it.
+ *
+ * Every byte takes 10 bit times at the configured baud rate in both
+ * directions. Received bytes only become available() when they would
+ * have arrived on a real line, measured on the virtual clock of the host
+ * Arduino environment.
+ */
+class EDIPSimulator : public EDIPTransport, private EDIPCommandListener {
+  public:
+    EDIPSimulator(unsigned char coordSize=COORD_SIZE);
+
+    void begin(long baud);
+    size_t write(const char* buf, size_t len);
+    int available();
+    int read();
+
+    /*! \brief Listener for decoded ESC commands
+     */
+    void setListener(EDIPCommandListener* listener);
+
+    /*! \brief Expect data without small protocol framing
+     */
+    void setSmallProtocol(boolean on);
+
+    /*! \brief Time between the last byte of a packet and its ACK (us)
+     */
+    void setAckDelay(unsigned long us);
+
+    /*! \brief Small protocol address
+     *
+     * With an address other than 0 the simulator ignores DC1 packets until
+     * it is selected with EDIPTFT::smallProtoSelect().
+     */
+    void setAddress(unsigned char address);
+
+    /*! \brief Simulate an unplugged display
+     *
+     * If \a on is false, nothing is answered.
+     */
+    void setConnected(boolean on);
+
+    /*! \brief Simulate a noisy line
+     *
+     * Every \a n-th packet is answered with NAK (0: never).
+     */
+    void setNakEvery(unsigned int n);
+
+    /*! \brief Simulate noise on the way back
+     *
+     * Every \a n-th response frame is sent with a wrong checksum (0: never).
+     * The display repeats the last response on request `DC2 1 R`.
+     */
+    void setCorruptEvery(unsigned int n);
+
+    /*! \brief Put bytes into the send buffer of the display
+     *
+     * e.g. touch key codes `ESC A 1 code`, read by EDIPTFT::readBuffer()
+     */
+    void queueSendBuffer(const char* data, size_t len);
+
+    /*! \brief Maximum number of bytes returned per send buffer request
+     */
+    void setSendPacketSize(unsigned char size);
+
+    /*! \brief Longest packet the display accepts, longer ones get NAK
+     */
+    void setMaxPacketSize(unsigned char size);
+
+    /*! \brief Baud rate of the display
+     *
+     * Until set here or changed with `DC2 2 B code`, the display follows
+     * begin(). Bytes are lost in both directions while begin() and the
+     * display rate differ.
+     */
+    void setDisplayBaud(long baud);
+
+    /*! \brief Highest baud rate the line carries reliably
+     *
+     * Above \a baud every 16th byte is garbled in either direction
+     * (0: no limit).
+     */
+    void setMaxBaud(long baud);
+
+    unsigned long displayBaud();
+
+    /*! \brief Screen contents
+     *
+     * 240x128 pixels for 1 byte coordinates, 320x240 otherwise; change
+     * with `screen().resize()`.
+     */
+    EDIPFramebuffer& screen();
+
+    unsigned long baud();
+    EDIPDecoder& decoder();
+    const EDIPSimStats& stats();
+    void resetStats();
+
+  private:
+    EDIPDecoder _decoder;
+    EDIPFramebuffer _screen;
+    EDIPCommandListener* _listener;
+    EDIPSimStats _stats;
+    std::deque<char> _sendBuffer;
+    std::deque<char> _rx;
+    std::deque<unsigned long long> _rxReady;
+    unsigned long _baud;
+    unsigned long _ackDelay;
+    unsigned long _nakEvery;
+    unsigned long _frames;
+    unsigned long _corruptEvery;
+    unsigned long _responses;
+    char _lastResponse[259];
+    unsigned char _lastResponseLen;
+    unsigned char _sendPacketSize;
+    unsigned char _maxPacketSize;
+    unsigned char _timeout;
+    unsigned long _displayBaud;
+    unsigned long _maxBaud;
+    unsigned long _lineBytes;
+    unsigned char _address;
+    boolean _selected;
+    boolean _connected;
+    boolean _smallprotocol;
+    unsigned long long _txLineFree;
+    unsigned long long _rxLineFree;
+    unsigned long long _lastByte;
+    unsigned char _state;
+    unsigned char _frame;
+    unsigned char _len;
+    unsigned char _bcc;
+    unsigned char _pos;
+    char _data[256];
+    unsigned long byteMicros();
+    boolean lineWorks();
+    char lineNoise(char c);
+    void command(const EDIPCommand& cmd);
+    void data(const EDIPCommand& cmd, unsigned long pos, char c);
+    void terminal(char c);
+    void hardcopy(int x1, int y1, int x2, int y2);
+    void receive(unsigned char c, unsigned long long at);
+    void packet(unsigned long long at);
+    void request(unsigned long long at);
+    void reply(const char* data, size_t len, unsigned long long at);
+    void replyFrame(char type, const char* data, unsigned char len,
+                    unsigned long long at);
+};
+#endif
@@ -0,0 +1,169 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Macro tool: turns recordings made with EDIPTFT::beginRecording() into
+// macro source for the vendor macro compiler, keeps them in intermediate
+// macro files and lists those. Build from the library root:
+//
+//   g++ -DARDUINO=100 -I. -Iextras/host EDIPTFT.cpp EDIPFont.cpp
+//       extras/host/*.cpp extras/macro/edipmacro.cpp -o edipmacro
+
+#include "EDIPMacroFile.h"
+#include "EDIPDecoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+class Lister : public EDIPCommandListener {
+  public:
+    void command(const EDIPCommand& cmd) {
+      unsigned char i;
+      printf("    ESC %c %c", cmd.group, cmd.code);
+      for (i = 0; i < cmd.nargs; i++) {
+        printf(" %d", cmd.args[i]);
+      }
+      if (cmd.hasText) {
+        printf(" \"%s\"", cmd.text);
+      }
+      printf("\n");
+    }
+};
+
+
+static int usage() {
+  fprintf(stderr,
+          "usage: edipmacro [-c coordsize] [-k file.kmc] [-o file.edm] "
+          "KINDnr=recording ...\n"
+          "       edipmacro -k file.kmc file.edm\n"
+          "       edipmacro -l file.edm\n"
+          "KIND: N macro, T touch macro, M menu macro, e.g. N1=page1.bin\n"
+          "-k: macro source, -o: intermediate macro file\n");
+  return 2;
+}
+
+
+static int list(const char* path) {
+  EDIPMacroFile file;
+  Lister lister;
+  size_t i, j;
+
+  if (!file.load(path)) {
+    fprintf(stderr, "%s: not a valid macro file\n", path);
+    return 1;
+  }
+  EDIPDecoder decoder(file.coordSize());
+  decoder.setListener(&lister);
+  for (i = 0; i < file.count(); i++) {
+    const EDIPMacro& macro = file.macro(i);
+    printf("%c%d: %u bytes\n", macro.kind, macro.number,
+           (unsigned int)macro.data.size());
+    decoder.reset();
+    for (j = 0; j < macro.data.size(); j++) {
+      decoder.feed(macro.data[j]);
+    }
+    if (decoder.busy()) {
+      printf("    (incomplete command)\n");
+    }
+  }
+  return 0;
+}
+
+
+static boolean addRecording(EDIPMacroFile& file, const char* arg) {
+  const char* path = strchr(arg, '=');
+  char* end;
+  long number;
+  char data[65536];
+  size_t len;
+  FILE* f;
+
+  if (!path) {
+    return false;
+  }
+  number = strtol(arg + 1, &end, 10);
+  if (end != path || number < 0 || number > 255) {
+    return false;
+  }
+  f = fopen(path + 1, "rb");
+  if (!f) {
+    perror(path + 1);
+    return false;
+  }
+  len = fread(data, 1, sizeof(data), f);
+  fclose(f);
+  return file.add(arg[0], number, data, len);
+}
+
+
+int main(int argc, char** argv) {
+  const char* out = 0;
+  const char* source = 0;
+  unsigned char coordSize = COORD_SIZE;
+  int i;
+
+  if (argc == 3 && strcmp(argv[1], "-l") == 0) {
+    return list(argv[2]);
+  }
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out = argv[++i];
+    }
+    else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+      source = argv[++i];
+    }
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      coordSize = atoi(argv[++i]);
+    }
+    else {
+      return usage();
+    }
+  }
+  if ((!out && !source) || i == argc) {
+    return usage();
+  }
+
+  EDIPMacroFile file(coordSize);
+  if (source && !out && i + 1 == argc && !strchr(argv[i], '=')) {
+    // source from an intermediate macro file
+    if (!file.load(argv[i])) {
+      fprintf(stderr, "%s: not a valid macro file\n", argv[i]);
+      return 1;
+    }
+  }
+  else {
+    for (; i < argc; i++) {
+      if (!addRecording(file, argv[i])) {
+        fprintf(stderr, "%s: bad recording\n", argv[i]);
+        return 1;
+      }
+    }
+  }
+  if (out && !file.save(out)) {
+    perror(out);
+    return 1;
+  }
+  if (source && !file.saveSource(source)) {
+    perror(source);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for EDIPBus, see README.md
+
+#include "EDIPBus.h"
+#include "EDIPSimulator.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+
+// Counts the decoded lines and texts
+class Commands : public EDIPCommandListener {
+  public:
+    unsigned int lines;
+    unsigned int texts;
+
+    Commands() : lines(0), texts(0) {}
+
+    void command(const EDIPCommand& cmd) {
+      if (cmd.group == 'G' && cmd.code == 'D') {
+        lines++;
+      }
+      else if (cmd.group == 'Z') {
+        texts++;
+      }
+    }
+};
+
+
+// Requests on a bus display fail at once and leave the queue alone
+static void requestOnBusDisplay() {
+  EDIPSimulator sim;
+  EDIPTFT link(sim);
+  EDIPBus bus(link);
+  EDIPBusDisplay display(bus, 1);
+  EDIPTFT& tft = display;
+  char data[16];
+  unsigned int pending;
+
+  sim.setAddress(1);
+  link.begin(115200);
+  display.drawLine(0, 0, 10, 10);
+  pending = bus.pending();
+
+  CHECK(tft.readBuffer(data, sizeof(data)) == EDIP_ERR_UNSUPPORTED);
+  CHECK(tft.datainBuffer() == EDIP_ERR_UNSUPPORTED);
+  CHECK(tft.smallProtoSelect(2) == EDIP_ERR_UNSUPPORTED);
+  CHECK(tft.lastError() == EDIP_ERR_UNSUPPORTED);
+  CHECK(bus.pending() == pending);
+  CHECK(bus.flush() == EDIP_OK);
+}
+
+
+// A command that doesn't fit while the display is unreachable is dropped
+// as a whole, the commands queued before it are kept
+static void dropWhenFull() {
+  EDIPSimulator sim;
+  EDIPTFT link(sim);
+  EDIPBus bus(link);
+  EDIPBusDisplay display(bus, 1);
+  Commands commands;
+  char text[EDIPBUS_QUEUE_SIZE];
+  unsigned int pending;
+
+  memset(text, 'x', sizeof(text) - 1);
+  text[sizeof(text) - 1] = 0;
+  sim.setAddress(1);
+  sim.setListener(&commands);
+  link.begin(115200);
+  CHECK(display.drawLine(0, 0, 10, 10) == EDIP_OK);
+  CHECK(display.drawLine(0, 10, 10, 0) == EDIP_OK);
+  pending = bus.pending();
+
+  sim.setConnected(false);
+  CHECK(display.drawText(0, 20, 'L', text) == EDIP_ERR_TIMEOUT);
+  CHECK(display.lastError() == EDIP_ERR_TIMEOUT);
+  CHECK(bus.pending() == pending);
+  CHECK(display.drawLine(0, 0, 10, 0) == EDIP_OK);
+  CHECK(bus.poll() == EDIP_ERR_TIMEOUT);
+
+  sim.setConnected(true);
+  CHECK(bus.flush() == EDIP_OK);
+  CHECK(bus.pending() == 0);
+  CHECK(commands.lines == 3);
+  CHECK(commands.texts == 0);
+  CHECK(sim.stats().errors == 0);
+}
+
+
+int main() {
+  requestOnBusDisplay();
+  dropWhenFull();
+  if (failures == 0) {
+    printf("bus: ok\n");
+  }
+  return failures ? 1 : 0;
+}
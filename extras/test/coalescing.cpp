@@ -0,0 +1,202 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for the commands EDIPTFT leaves out or merges, see README.md
+
+#include "EDIPTFT.h"
+#include "EDIPSimulator.h"
+#include <stdio.h>
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+
+// Passes everything to the simulator and keeps what EDIPTFT sent
+class Wire : public EDIPTransport {
+  public:
+    EDIPSimulator& sim;
+    std::string sent;
+
+    Wire(EDIPSimulator& simulator) : sim(simulator) {}
+
+    void begin(long baud) {
+      sim.begin(baud);
+    }
+
+    size_t write(const char* buf, size_t len) {
+      sent.append(buf, len);
+      return sim.write(buf, len);
+    }
+
+    int available() {
+      return sim.available();
+    }
+
+    int read() {
+      return sim.read();
+    }
+};
+
+
+// Small protocol packet carrying the \a len bytes of \a data
+static std::string packet(const char* data, size_t len) {
+  std::string frame;
+  unsigned char bcc = DC1 + len;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    bcc += data[i];
+  }
+  frame += (char)DC1;
+  frame += (char)len;
+  frame.append(data, len);
+  frame += (char)bcc;
+  return frame;
+}
+
+#define PACKET(s) packet(s, sizeof(s) - 1)
+
+
+// Repeated state commands are left out until a packet fails
+static void stateCache() {
+  EDIPSimulator sim(1);
+  Wire wire(sim);
+  EDIPTFT tft(wire, true, 1);
+
+  tft.begin(115200);
+  tft.setStateCache(true);
+  tft.setTimeouts(20, 0, 0);
+  CHECK(tft.setTextColor(EA_RED, EA_BLACK) == EDIP_OK);
+  CHECK(tft.setTextFont(EA_FONT6X8) == EDIP_OK);
+  CHECK(tft.setTextColor(EA_RED, EA_BLACK) == EDIP_OK);
+  CHECK(tft.setTextFont(EA_FONT6X8) == EDIP_OK);
+  CHECK(tft.setTextColor(EA_RED, EA_BLUE) == EDIP_OK);
+  CHECK(wire.sent == PACKET("\x1b" "FZ\x03\x01") + PACKET("\x1bZF\x02") +
+        PACKET("\x1b" "FZ\x03\x02"));
+
+  // the display may have missed the font of a failed packet
+  wire.sent.clear();
+  sim.setConnected(false);
+  CHECK(tft.setTextFont(EA_FONT7X12) == EDIP_ERR_TIMEOUT);
+  sim.setConnected(true);
+  wire.sent.clear();
+  CHECK(tft.setTextFont(EA_FONT7X12) == EDIP_OK);
+  CHECK(tft.setTextColor(EA_RED, EA_BLUE) == EDIP_OK);
+  CHECK(wire.sent == PACKET("\x1bZF\x03") + PACKET("\x1b" "FZ\x03\x02"));
+}
+
+
+// Only the newest value of each bargraph and instrument goes out, once
+// per interval, and only if it is not on screen already
+static void values() {
+  EDIPSimulator sim(1);
+  Wire wire(sim);
+  EDIPTFT tft(wire, true, 1);
+
+  tft.begin(115200);
+  tft.setTimeouts(20, 0, 0);
+  tft.setUpdateRate(50);
+  CHECK(tft.flushValues() == EDIP_OK);
+  CHECK(tft.updateBargraph(1, 10) == EDIP_OK);
+  CHECK(tft.updateBargraph(1, 20) == EDIP_OK);
+  CHECK(tft.updateInstrument(2, 5) == EDIP_OK);
+  CHECK(tft.updateBargraph(1, 30) == EDIP_OK);
+  CHECK(wire.sent.empty());
+  delay(50);
+  tft.poll();
+  CHECK(wire.sent == PACKET("\x1b" "BA\x01\x1e\x1bIA\x02\x05"));
+
+  wire.sent.clear();
+  CHECK(tft.updateBargraph(1, 30) == EDIP_OK);
+  delay(50);
+  tft.poll();
+  CHECK(wire.sent.empty());
+
+  // after a failed value frame the value is sent again
+  sim.setConnected(false);
+  // the interval has passed, the value goes out right away
+  CHECK(tft.updateBargraph(1, 40) == EDIP_ERR_TIMEOUT);
+  sim.setConnected(true);
+  wire.sent.clear();
+  CHECK(tft.updateBargraph(1, 40) == EDIP_OK);
+  delay(50);
+  tft.poll();
+  CHECK(wire.sent == PACKET("\x1b" "BA\x01\x28"));
+}
+
+
+// Adjacent rectangles and continued lines are merged, shapes painted over
+// are dropped, errors show up when the shapes are sent
+static void geometry() {
+  EDIPSimulator sim(1);
+  Wire wire(sim);
+  EDIPTFT tft(wire, true, 1);
+
+  tft.begin(115200);
+  tft.setTimeouts(20, 0, 0);
+  tft.setGeometryCoalescing(true);
+  CHECK(tft.fillRect(0, 0, 9, 9) == EDIP_OK);
+  CHECK(tft.fillRect(10, 0, 19, 9) == EDIP_OK);
+  CHECK(tft.drawLine(0, 20, 10, 20) == EDIP_OK);
+  CHECK(tft.drawLine(10, 20, 30, 20) == EDIP_OK);
+  // covered even if the line is as thick as it can be
+  CHECK(tft.drawLine(20, 50, 25, 55) == EDIP_OK);
+  CHECK(tft.fillRect(0, 30, 40, 70) == EDIP_OK);
+  CHECK(wire.sent.empty());
+  CHECK(tft.flush() == EDIP_OK);
+  CHECK(wire.sent == PACKET("\x1bRS\x00\x00\x13\x09"
+                            "\x1bGD\x00\x14\x1e\x14"
+                            "\x1bRS\x00\x1e\x28\x46"));
+
+  // clearing the display drops everything before it
+  wire.sent.clear();
+  CHECK(tft.fillRect(0, 0, 9, 9) == EDIP_OK);
+  CHECK(tft.drawLine(0, 20, 10, 20) == EDIP_OK);
+  CHECK(tft.deleteDisplay() == EDIP_OK);
+  CHECK(wire.sent == PACKET("\x1b" "DL"));
+
+  wire.sent.clear();
+  sim.setConnected(false);
+  CHECK(tft.fillRect(0, 0, 9, 9) == EDIP_OK);
+  CHECK(tft.flush() == EDIP_ERR_TIMEOUT);
+  CHECK(wire.sent == PACKET("\x1bRS\x00\x00\x09\x09"));
+}
+
+
+int main() {
+  stateCache();
+  values();
+  geometry();
+  if (failures == 0) {
+    printf("coalescing: ok\n");
+  }
+  return failures ? 1 : 0;
+}
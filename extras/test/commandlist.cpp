@@ -0,0 +1,97 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for EDIPCommandList, see README.md
+
+#include "EDIPCommandList.h"
+#include "EDIPSimulator.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+
+// Marks must point at their own command when shapes are coalesced
+static void markWithCoalescing() {
+  EDIPSimulator sim;
+  EDIPTFT tft(sim);
+  char buf[64];
+  EDIPCommandList list(buf, sizeof(buf));
+  unsigned int box, value;
+
+  tft.begin(115200);
+  tft.setGeometryCoalescing(true);
+  list.begin(tft);
+  box = list.mark();
+  tft.fillRect(0, 10, 100, 20);
+  value = list.mark();
+  tft.updateBargraph(1, 0);
+  CHECK(list.end() > 0);
+
+  CHECK(box == 0);
+  CHECK(buf[box] == ESC && buf[box + 1] == 'R' && buf[box + 2] == 'S');
+  CHECK(buf[value] == ESC && buf[value + 1] == 'B' &&
+        buf[value + 2] == 'A');
+  CHECK(list.patchByte(value, 1, 77));
+  CHECK(buf[value + 4] == 77);
+  // the rectangle is untouched
+  CHECK(buf[box + 4] == 10);
+}
+
+
+// Bargraph coordinates follow the bargraph number
+static void patchBargraphCoord() {
+  EDIPSimulator sim;
+  EDIPTFT tft(sim);
+  char buf[64];
+  EDIPCommandList list(buf, sizeof(buf));
+  unsigned int bar;
+
+  tft.begin(115200);
+  list.begin(tft);
+  bar = list.mark();
+  tft.defineBargraph('R', 3, 10, 20, 110, 40, 0, 100, 1, 0);
+  CHECK(list.end() > 0);
+
+  CHECK(list.patchCoord(bar, 0, 99, 1));
+  CHECK(buf[bar + 3] == 3);
+  CHECK(buf[bar + 4] == 99);
+  CHECK(buf[bar + 5] == 20);
+}
+
+
+int main() {
+  markWithCoalescing();
+  patchBargraphCoord();
+  if (failures == 0) {
+    printf("commandlist: ok\n");
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for EDIPFont, see README.md
+
+#include "EDIPFont.h"
+#include "EDIPSimulator.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+
+// Area of the pixels that differ from the background
+static EDIPRect drawn(EDIPFramebuffer& screen) {
+  unsigned long bg = screen.pixel(0, 0);
+  EDIPRect r = {screen.width(), screen.height(), -1, -1};
+  int x, y;
+
+  for (y = 0; y < screen.height(); y++) {
+    for (x = 0; x < screen.width(); x++) {
+      if (screen.pixel(x, y) != bg) {
+        r.x1 = min(r.x1, x);
+        r.y1 = min(r.y1, y);
+        r.x2 = max(r.x2, x);
+        r.y2 = max(r.y2, y);
+      }
+    }
+  }
+  return r;
+}
+
+
+// bounds() covers exactly what the display draws, for all fonts, angles
+// and justifications
+static void boundsMatchScreen() {
+  static const char justifications[] = {'L', 'C', 'R'};
+  static const char* texts[] = {"A", "Ab|c d", "~x@|\\||yz"};
+  EDIPSimulator sim(2);
+  EDIPTFT tft(sim, true, 2);
+  EDIPRect want, got;
+  char font, angle;
+  unsigned char j, t;
+
+  tft.begin(115200);
+  sim.screen().resize(600, 600);
+  tft.setTextColor(EA_RED, EA_BLUE);
+  for (font = EA_FONT8X8; font <= EA_BIGZIF57; font++) {
+    EDIPFont metrics(font);
+    tft.setTextFont(font);
+    for (angle = 0; angle < 4; angle++) {
+      tft.setTextAngle(angle);
+      for (j = 0; j < sizeof(justifications); j++) {
+        for (t = 0; t < sizeof(texts) / sizeof(texts[0]); t++) {
+          tft.deleteDisplay();
+          tft.drawText(300, 300, justifications[j], texts[t]);
+          want = drawn(sim.screen());
+          got = metrics.bounds(300, 300, justifications[j], texts[t],
+                               angle);
+          if (got.x1 != want.x1 || got.y1 != want.y1 ||
+              got.x2 != want.x2 || got.y2 != want.y2) {
+            printf("font %d angle %d %c \"%s\": %d,%d %d,%d, drawn "
+                   "%d,%d %d,%d\n", font, angle, justifications[j],
+                   texts[t], got.x1, got.y1, got.x2, got.y2, want.x1,
+                   want.y1, want.x2, want.y2);
+            failures++;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+// The proportional fonts are never measured narrower than they are high
+static void proportionalUpperBound() {
+  EDIPFont geneva(EA_GENEVA10);
+  EDIPFont bigzif(EA_BIGZIF57);
+
+  CHECK(geneva.charWidth('W') >= geneva.height());
+  CHECK(geneva.charWidth('i') == geneva.charWidth('W'));
+  CHECK(bigzif.textWidth("12:30") == 5 * bigzif.height());
+}
+
+
+int main() {
+  boundsMatchScreen();
+  proportionalUpperBound();
+  if (failures == 0) {
+    printf("font: ok\n");
+  }
+  return failures ? 1 : 0;
+}
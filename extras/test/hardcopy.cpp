@@ -0,0 +1,118 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for the streaming EDIPHardcopy API, see README.md
+
+#include "EDIPHardcopy.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+class Pixels : public EDIPPixelSink {
+  public:
+    int width, height, count;
+    unsigned long rgb[2][2];
+
+    Pixels() : width(0), height(0), count(0) {}
+
+    void begin(int w, int h) {
+      width = w;
+      height = h;
+    }
+
+    void pixel(int x, int y, unsigned char r, unsigned char g,
+               unsigned char b) {
+      count++;
+      if (x >= 0 && x < 2 && y >= 0 && y < 2) {
+        rgb[y][x] = (unsigned long)r << 16 | g << 8 | b;
+      }
+    }
+};
+
+
+// 2x2 pixel 24 bit BMP in one ESC U record, rows top-down (height -2)
+static void topDown() {
+  char data[3 + 54 + 16] = { ESC, 'U', 54 + 16, 'B', 'M' };
+  char* bmp = data + 3;
+  char* p = bmp + 54;
+  Pixels sink;
+  EDIPHardcopy hardcopy;
+
+  bmp[10] = 54;      // offset of the pixels
+  bmp[14] = 40;      // info header size
+  bmp[18] = 2;       // width
+  bmp[22] = -2;      // height, top-down
+  bmp[23] = -1;
+  bmp[24] = -1;
+  bmp[25] = -1;
+  bmp[26] = 1;       // planes
+  bmp[28] = 24;      // bits per pixel
+  // rows of 6 bytes BGR, padded to 8
+  p[2] = 0x11;       // (0, 0) red
+  p[4] = 0x22;       // (1, 0) green
+  p[8 + 0] = 0x33;   // (0, 1) blue
+  p[8 + 3] = 0x44;   // (1, 1) blue
+
+  hardcopy.begin(sink);
+  CHECK(!hardcopy.done());
+  hardcopy.feed(data, sizeof(data));
+  CHECK(hardcopy.done());
+  CHECK(hardcopy.error() == EDIP_OK);
+  CHECK(sink.width == 2 && sink.height == 2);
+  CHECK(sink.count == 4);
+  CHECK(sink.rgb[0][0] == 0x110000);
+  CHECK(sink.rgb[0][1] == 0x002200);
+  CHECK(sink.rgb[1][0] == 0x000033);
+  CHECK(sink.rgb[1][1] == 0x000044);
+}
+
+
+static void notAnImage() {
+  char data[] = { ESC, 'U', 4, 'X', 'Y', 0, 0 };
+  Pixels sink;
+  EDIPHardcopy hardcopy;
+
+  hardcopy.begin(sink);
+  hardcopy.feed(data, sizeof(data));
+  CHECK(hardcopy.done());
+  CHECK(hardcopy.error() == EDIP_ERR_IMAGE);
+  CHECK(sink.count == 0);
+}
+
+
+int main() {
+  topDown();
+  notAnImage();
+  if (failures == 0) {
+    printf("hardcopy: ok\n");
+  }
+  return failures ? 1 : 0;
+}
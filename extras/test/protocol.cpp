@@ -0,0 +1,237 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for the small protocol handling of EDIPTFT, see README.md
+
+#include "EDIPTFT.h"
+#include "EDIPSimulator.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+
+// Passes everything to the simulator and keeps what EDIPTFT sent
+class Wire : public EDIPTransport {
+  public:
+    EDIPSimulator& sim;
+    std::string sent;
+
+    Wire(EDIPSimulator& simulator) : sim(simulator) {}
+
+    void begin(long baud) {
+      sim.begin(baud);
+    }
+
+    size_t write(const char* buf, size_t len) {
+      sent.append(buf, len);
+      return sim.write(buf, len);
+    }
+
+    int available() {
+      return sim.available();
+    }
+
+    int read() {
+      return sim.read();
+    }
+};
+
+
+// Small protocol packet carrying \a data
+static std::string packet(const std::string& data) {
+  std::string frame;
+  unsigned char bcc = DC1 + data.size();
+  size_t i;
+
+  for (i = 0; i < data.size(); i++) {
+    bcc += data[i];
+  }
+  frame += (char)DC1;
+  frame += (char)data.size();
+  frame += data;
+  frame += (char)bcc;
+  return frame;
+}
+
+
+// drawLine(0, 0, 10, 10) and drawLine(10, 10, 20, 0), 1 byte coordinates
+static const std::string line1("\x1bGD\x00\x00\x0a\x0a", 7);
+static const std::string line2("\x1bGD\x0a\x0a\x14\x00", 7);
+
+
+// Batched commands go out in one packet on flush()
+static void batching() {
+  EDIPSimulator sim(1);
+  Wire wire(sim);
+  EDIPTFT tft(wire, true, 1);
+
+  tft.begin(115200);
+  tft.setBatching(true);
+  CHECK(tft.drawLine(0, 0, 10, 10) == EDIP_OK);
+  CHECK(tft.drawLine(10, 10, 20, 0) == EDIP_OK);
+  CHECK(wire.sent.empty());
+  CHECK(tft.flush() == EDIP_OK);
+  CHECK(wire.sent == packet(line1 + line2));
+  CHECK(sim.stats().packets == 1);
+
+  // without batching every command is a packet of its own
+  wire.sent.clear();
+  tft.setBatching(false);
+  CHECK(tft.drawLine(0, 0, 10, 10) == EDIP_OK);
+  CHECK(tft.drawLine(10, 10, 20, 0) == EDIP_OK);
+  CHECK(wire.sent == packet(line1) + packet(line2));
+}
+
+
+// A NAK is answered by sending the packet again; without any answer the
+// packet is given up after the retries, which back off exponentially
+static void timeoutsAndRetries() {
+  EDIPSimulator sim(1);
+  Wire wire(sim);
+  EDIPTFT tft(wire, true, 1);
+  unsigned long start;
+
+  tft.begin(115200);
+  tft.setTimeouts(20, 2, 10);
+  sim.setNakEvery(2);
+  CHECK(tft.drawLine(0, 0, 10, 10) == EDIP_OK);
+  CHECK(tft.drawLine(10, 10, 20, 0) == EDIP_OK);
+  CHECK(wire.sent == packet(line1) + packet(line2) + packet(line2));
+  CHECK(sim.stats().naks == 1);
+  CHECK(sim.stats().commands == 2);
+
+  wire.sent.clear();
+  sim.setNakEvery(0);
+  sim.setConnected(false);
+  start = millis();
+  CHECK(tft.drawLine(0, 0, 10, 10) == EDIP_ERR_TIMEOUT);
+  // three ACK timeouts and the backoff of 10 and 20 ms in between
+  CHECK(millis() - start >= 3 * 20 + 10 + 20);
+  CHECK(wire.sent == packet(line1) + packet(line1) + packet(line1));
+  CHECK(tft.lastError() == EDIP_ERR_TIMEOUT);
+}
+
+
+// In async mode a packet waits for the ACK of the one before it, a packet
+// that is never acknowledged is dropped after its retries
+static void async() {
+  EDIPSimulator sim(1);
+  Wire wire(sim);
+  EDIPTFT tft(wire, true, 1);
+  unsigned int first, second, tries;
+
+  tft.begin(115200);
+  tft.setAsync(true);
+  tft.setTimeouts(20, 2, 0);
+  sim.setAckDelay(5000);
+  CHECK(tft.drawLine(0, 0, 10, 10) == EDIP_OK);
+  first = tft.lastPacket();
+  CHECK(tft.drawLine(10, 10, 20, 0) == EDIP_OK);
+  second = tft.lastPacket();
+  CHECK(wire.sent == packet(line1));
+  CHECK(tft.pendingPackets() == 2);
+  CHECK(tft.packetStatus(first) == EDIP_SENT);
+  CHECK(tft.packetStatus(second) == EDIP_QUEUED);
+  for (tries = 0; tft.pendingPackets() > 0 && tries < 100000; tries++) {
+    tft.poll();
+  }
+  CHECK(wire.sent == packet(line1) + packet(line2));
+  CHECK(tft.packetStatus(first) == EDIP_DONE);
+  CHECK(tft.packetStatus(second) == EDIP_DONE);
+
+  wire.sent.clear();
+  sim.setConnected(false);
+  CHECK(tft.drawLine(0, 0, 10, 10) == EDIP_OK);
+  first = tft.lastPacket();
+  for (tries = 0; tft.pendingPackets() > 0 && tries < 100000; tries++) {
+    tft.poll();
+  }
+  CHECK(wire.sent == packet(line1) + packet(line1) + packet(line1));
+  CHECK(tft.packetStatus(first) == EDIP_FAILED);
+  CHECK(tft.lastError() == EDIP_ERR_TIMEOUT);
+}
+
+
+// A full send buffer takes longer than the ACK timeout at low baud rates,
+// but every byte arrives in time
+static void slowResponse() {
+  static const long bauds[] = {9600, 4800, 2400};
+  char events[EDIPTFT_RX_SIZE];
+  char data[EDIPTFT_RX_SIZE];
+  unsigned char i;
+
+  for (i = 0; i < sizeof(events); i++) {
+    events[i] = i;
+  }
+  for (i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+    EDIPSimulator sim;
+    EDIPTFT tft(sim);
+
+    tft.begin(bauds[i]);
+    sim.queueSendBuffer(events, sizeof(events));
+    CHECK(tft.readBuffer(data, sizeof(data)) == (int)sizeof(data));
+    CHECK(memcmp(data, events, sizeof(data)) == 0);
+  }
+}
+
+
+// negotiate() fails if the display keeps sending too long responses
+static void negotiateResponseSize() {
+  EDIPSimulator sim;
+  EDIPTFT tft(sim);
+
+  tft.begin(115200);
+  tft.setTimeouts(100, 0, 0);
+  sim.setSendPacketSize(2 * EDIPTFT_RX_SIZE);
+  // the protocol info is answered, the new response size is refused
+  sim.setNakEvery(2);
+  CHECK(tft.negotiate() == EDIP_ERR_NAK);
+  CHECK(tft.lastError() == EDIP_ERR_NAK);
+  CHECK(sim.displayBaud() == 115200);
+
+  sim.setNakEvery(0);
+  CHECK(tft.negotiate() == EDIP_OK);
+}
+
+
+int main() {
+  batching();
+  async();
+  timeoutsAndRetries();
+  slowResponse();
+  negotiateResponseSize();
+  if (failures == 0) {
+    printf("protocol: ok\n");
+  }
+  return failures ? 1 : 0;
+}
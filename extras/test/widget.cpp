@@ -0,0 +1,135 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Checks for EDIPWidget, see README.md
+
+#include "EDIPWidget.h"
+#include "EDIPSimulator.h"
+#include <stdio.h>
+#include <set>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+
+// Keeps the touch areas on the display by their down code
+class TouchAreas : public EDIPCommandListener {
+  public:
+    std::set<int> areas;
+    unsigned int bargraphs;
+    unsigned int clears;
+
+    TouchAreas() : bargraphs(0), clears(0) {}
+
+    void command(const EDIPCommand& cmd) {
+      if (cmd.group == 'A' && (cmd.code == 'T' || cmd.code == 'K')) {
+        areas.insert(cmd.args[4] ? cmd.args[4] : cmd.args[5] + 256);
+      }
+      else if (cmd.group == 'A' && cmd.code == 'L') {
+        if (cmd.args[0] == 0) {
+          areas.clear();
+        }
+        else {
+          areas.erase(cmd.args[0]);
+          areas.erase(cmd.args[0] + 256);
+        }
+      }
+      else if (cmd.group == 'B' && cmd.code == 'R') {
+        bargraphs++;
+      }
+      else if (cmd.group == 'R' && cmd.code == 'L') {
+        clears++;
+      }
+    }
+};
+
+
+// Relabeling a key without down code leaves the other keys alone
+static void relabelKey() {
+  EDIPSimulator sim;
+  EDIPTFT tft(sim);
+  TouchAreas touch;
+  EDIPScreen screen(tft);
+  EDIPTouchKey ok(0, 0, 39, 19, 0, 'o', "OK");
+  EDIPTouchKey cancel(40, 0, 79, 19, 'c', 0, "Cancel");
+
+  sim.setListener(&touch);
+  tft.begin(115200);
+  screen.add(ok);
+  screen.add(cancel);
+  CHECK(screen.render() == EDIP_OK);
+  CHECK(touch.areas.size() == 2);
+
+  ok.setText("Yes");
+  CHECK(screen.render() == EDIP_OK);
+  CHECK(touch.areas.size() == 2);
+  CHECK(touch.areas.count('c') == 1);
+  CHECK(touch.areas.count('o' + 256) == 1);
+
+  cancel.setText("No");
+  CHECK(screen.render() == EDIP_OK);
+  CHECK(touch.areas.size() == 2);
+}
+
+
+// After the display was cleared all widgets are drawn as new
+static void redrawAfterClear() {
+  EDIPSimulator sim;
+  EDIPTFT tft(sim);
+  TouchAreas touch;
+  EDIPScreen screen(tft);
+  EDIPBargraph bar('R', 1, 0, 20, 99, 29, 0, 100, 1, 0);
+  EDIPRectangle box(0, 40, 9, 49, EA_RED);
+
+  sim.setListener(&touch);
+  tft.begin(115200);
+  screen.add(bar);
+  screen.add(box);
+  CHECK(screen.render() == EDIP_OK);
+  CHECK(touch.bargraphs == 1);
+
+  CHECK(tft.deleteDisplay() == EDIP_OK);
+  screen.invalidate();
+  // nothing left to clear at the old position
+  box.setBounds(10, 40, 19, 49);
+  CHECK(screen.render() == EDIP_OK);
+  CHECK(touch.bargraphs == 2);
+  CHECK(touch.clears == 0);
+}
+
+
+int main() {
+  relabelKey();
+  redrawAfterClear();
+  if (failures == 0) {
+    printf("widget: ok\n");
+  }
+  return failures ? 1 : 0;
+}
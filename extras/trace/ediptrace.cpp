@@ -0,0 +1,311 @@
+//
+// Library for controlling Electronic Assembly eDIPTFT displays
+//
+//      Copyright (c) 2013 Stefan Gofferje. All rights reserved.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+//      This library is distributed in the hope that it will be
+//      useful, but WITHOUT ANY WARRANTY; without even the implied
+//      warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+//      PURPOSE.  See the GNU Lesser General Public License for more
+//      details.
+//
+//      You should have received a copy of the GNU Lesser General
+//      Public License along with this library; if not, write to the
+//      Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//      Boston, MA 02110-1301 USA
+//
+
+// Trace tool: lists traces written by EDIPTrace, replays them into the
+// display simulator and renders them. Build from the library root:
+//
+//   g++ -DARDUINO=100 -I. -Iextras/host EDIPTFT.cpp EDIPFont.cpp
+//       EDIPTrace.cpp extras/host/*.cpp extras/trace/ediptrace.cpp
+//       -o ediptrace
+
+#include "EDIPTrace.h"
+#include "EDIPDecoder.h"
+#include "EDIPFileStream.h"
+#include "EDIPSimulator.h"
+#include "EDIPFramebuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+class Lister : public EDIPCommandListener {
+  public:
+    void command(const EDIPCommand& cmd) {
+      unsigned char i;
+      printf("%14s ESC %c %c", "", cmd.group, cmd.code);
+      for (i = 0; i < cmd.nargs; i++) {
+        printf(" %d", cmd.args[i]);
+      }
+      if (cmd.hasText) {
+        printf(" \"%s\"", cmd.text);
+      }
+      printf("\n");
+    }
+};
+
+// Takes the commands out of the DC1 packets in the sent bytes
+class Unframer {
+  public:
+    Unframer(EDIPDecoder& decoder, boolean list=true) :
+        _decoder(decoder), _list(list), _state(0) {}
+
+    void feed(unsigned char c) {
+      switch (_state) {
+        case 0:
+          _state = c == DC1 ? 1 : c == DC2 ? 3 : 0;
+          break;
+        case 1:
+          _left = c;
+          _state = _left > 0 ? 2 : 4;
+          break;
+        case 2:
+          _decoder.feed(c);
+          _state = --_left > 0 ? 2 : 4;
+          break;
+        case 3:
+          // DC2 requests are listed, not decoded
+          _left = c;
+          _state = _left > 0 ? 5 : 4;
+          break;
+        case 5:
+          if (_list) {
+            printf("%14s DC2 %c\n", "", c);
+          }
+          _state = --_left > 0 ? 6 : 4;
+          break;
+        case 6:
+          _state = --_left > 0 ? 6 : 4;
+          break;
+        default:
+          // checksum
+          _state = 0;
+      }
+    }
+
+  private:
+    EDIPDecoder& _decoder;
+    boolean _list;
+    unsigned char _state;
+    unsigned char _left;
+};
+
+
+static int usage() {
+  fprintf(stderr,
+          "usage: ediptrace [-c coordsize] -l trace.bin\n"
+          "       ediptrace [-c coordsize] [-s percent] -r trace.bin\n"
+          "       ediptrace [-c coordsize] [-g ms] [-o image] -p trace.bin\n"
+          "-s: replay speed, 100 recorded speed (default), 0 as fast as "
+          "the display answers\n"
+          "-p: render the sent commands, with the overdraw of each frame;\n"
+          "    a frame ends after -g ms (default 20) without sending,\n"
+          "    -o writes the last screen (.png, otherwise PPM)\n");
+  return 2;
+}
+
+
+static unsigned long get32(const unsigned char* data) {
+  return (unsigned long)data[0] | (unsigned long)data[1] << 8 |
+         (unsigned long)data[2] << 16 | (unsigned long)data[3] << 24;
+}
+
+
+static int list(const char* path, unsigned char coordSize) {
+  FILE* f = fopen(path, "rb");
+  unsigned char head[9], data[255];
+  unsigned long first = 0;
+  unsigned long records = 0;
+  EDIPDecoder decoder(coordSize);
+  Unframer unframer(decoder);
+  Lister lister;
+  unsigned int i;
+
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  if (fread(head, 1, 9, f) != 9 || memcmp(head, "EDIPTRAC\1", 9) != 0) {
+    fprintf(stderr, "%s: not a trace\n", path);
+    fclose(f);
+    return 1;
+  }
+  decoder.setListener(&lister);
+  while (fread(head, 1, 6, f) == 6) {
+    if (fread(data, 1, head[1], f) != head[1]) {
+      printf("(truncated)\n");
+      break;
+    }
+    if (records++ == 0) {
+      first = get32(head + 2);
+    }
+    printf("%10.3f ms %c", (get32(head + 2) - first) / 1000.0, head[0]);
+    if (head[0] == EDIPTRACE_BAUD && head[1] == 4) {
+      printf(" %lu Bd\n", get32(data));
+      continue;
+    }
+    for (i = 0; i < head[1]; i++) {
+      printf(" %02x", data[i]);
+    }
+    printf("\n");
+    if (head[0] == EDIPTRACE_TX) {
+      for (i = 0; i < head[1]; i++) {
+        unframer.feed(data[i]);
+      }
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+
+static void frameReport(EDIPFramebuffer& screen, unsigned int frame,
+                        unsigned long at) {
+  EDIPOverdraw o = screen.overdraw();
+
+  if (o.writes == 0) {
+    return;
+  }
+  printf("%5u %10.3f %10lu %10lu %10lu %8.1f\n", frame, at / 1000.0,
+         o.writes, o.pixels, o.changed,
+         o.changed ? (double)o.writes / o.changed : 0.0);
+}
+
+
+static int render(const char* path, unsigned char coordSize,
+                  unsigned long gap, const char* image) {
+  FILE* f = fopen(path, "rb");
+  unsigned char head[9], data[255];
+  unsigned long first = 0, start = 0, last = 0, at;
+  unsigned long records = 0;
+  unsigned int frame = 0;
+  // same screen sizes as the simulator
+  EDIPFramebuffer screen(coordSize == 1 ? 240 : 320,
+                         coordSize == 1 ? 128 : 240);
+  EDIPDecoder decoder(coordSize);
+  Unframer unframer(decoder, false);
+  unsigned int i;
+  boolean ok;
+
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  if (fread(head, 1, 9, f) != 9 || memcmp(head, "EDIPTRAC\1", 9) != 0) {
+    fprintf(stderr, "%s: not a trace\n", path);
+    fclose(f);
+    return 1;
+  }
+  decoder.setListener(&screen);
+  printf("frame   start ms     writes     pixels    changed overdraw\n");
+  while (fread(head, 1, 6, f) == 6 && fread(data, 1, head[1], f) == head[1]) {
+    if (records++ == 0) {
+      first = get32(head + 2);
+    }
+    if (head[0] != EDIPTRACE_TX) {
+      continue;
+    }
+    at = get32(head + 2) - first;
+    if (at - last >= gap * 1000) {
+      frameReport(screen, frame++, start);
+      screen.newFrame();
+      start = at;
+    }
+    last = at;
+    for (i = 0; i < head[1]; i++) {
+      unframer.feed(data[i]);
+    }
+  }
+  frameReport(screen, frame, start);
+  fclose(f);
+  if (image) {
+    i = strlen(image);
+    if (i > 4 && strcmp(image + i - 4, ".png") == 0) {
+      ok = screen.savePNG(image);
+    }
+    else {
+      ok = screen.savePPM(image);
+    }
+    if (!ok) {
+      perror(image);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+static int replay(const char* path, unsigned char coordSize,
+                  unsigned int speed) {
+  EDIPFileStream file(path);
+  EDIPSimulator sim(coordSize);
+  EDIPTraceReplay replay(sim);
+
+  if (!file.isOpen()) {
+    perror(path);
+    return 1;
+  }
+  if (!replay.play(file, speed)) {
+    fprintf(stderr, "%s: not a trace or truncated\n", path);
+    return 1;
+  }
+  const EDIPSimStats& stats = sim.stats();
+  printf("records      %lu\n", replay.records());
+  printf("recorded     %.3f ms\n", replay.recorded() / 1000.0);
+  printf("replayed     %.3f ms\n", replay.elapsed() / 1000.0);
+  printf("packets      %lu\n", stats.packets);
+  printf("requests     %lu\n", stats.requests);
+  printf("errors       %lu\n", stats.errors);
+  printf("missing      %lu\n", replay.missing());
+  printf("mismatched   %lu\n", replay.mismatched());
+  return 0;
+}
+
+
+int main(int argc, char** argv) {
+  unsigned char coordSize = COORD_SIZE;
+  unsigned int speed = 100;
+  unsigned long gap = 20;
+  const char* image = 0;
+  char mode = 0;
+  int i;
+
+  for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      coordSize = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      speed = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+      gap = atol(argv[++i]);
+    }
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      image = argv[++i];
+    }
+    else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "-r") == 0 ||
+             strcmp(argv[i], "-p") == 0) {
+      mode = argv[i][1];
+    }
+    else {
+      return usage();
+    }
+  }
+  if (!mode || i + 1 != argc) {
+    return usage();
+  }
+  if (mode == 'l') {
+    return list(argv[i], coordSize);
+  }
+  if (mode == 'p') {
+    return render(argv[i], coordSize, gap, image);
+  }
+  return replay(argv[i], coordSize, speed);
+}